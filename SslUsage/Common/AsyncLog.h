@@ -0,0 +1,326 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+
+
+// a log record is formatted only by the writer thread - the caller just fills in the fields
+struct LogRecord
+{
+    qint64 timestamp = 0;
+    QtMsgType type = QtInfoMsg;
+    char const* event = "";
+    QVector<QPair<char const*, QString>> fields;
+};
+
+
+// bounded multi-producer single-consumer queue, a push never blocks but fails once it is full
+//
+// every cell's sequence tells whether it is free to be written (== position) or ready to be read
+// (== position + 1) - producers claim a position with a single CAS, the consumer needs none
+template <typename T>
+class RingBuffer
+{
+public:
+    // the capacity has to be a power of two
+    explicit RingBuffer(size_t const aCapacity)
+        : mask(aCapacity - 1)
+        , cells(std::make_unique<Cell[]>(aCapacity))
+    {
+        Q_ASSERT(aCapacity > 0 && (aCapacity & mask) == 0);
+        for (size_t i = 0; i < aCapacity; ++i)
+        {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPush(T&& aValue)
+    {
+        auto position = head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto& cell = cells[position & mask];
+            auto const sequence = cell.sequence.load(std::memory_order_acquire);
+            auto const diff = static_cast<std::ptrdiff_t>(sequence - position);
+
+            if (diff == 0)
+            {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.value = std::move(aValue);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                // the consumer didn't read this cell yet - full
+                return false;
+            }
+            else
+            {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // only to be called by the one consumer
+    bool tryPop(T& aValue)
+    {
+        auto& cell = cells[tail & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != tail + 1)
+        {
+            return false;
+        }
+
+        aValue = std::move(cell.value);
+        cell.sequence.store(tail + mask + 1, std::memory_order_release);
+        ++tail;
+        return true;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence {0};
+        T value;
+    };
+
+    size_t const mask;
+    std::unique_ptr<Cell[]> cells;
+
+    // producers and the consumer don't share a cache line
+    alignas(64) std::atomic<size_t> head {0};
+    alignas(64) size_t tail = 0;
+};
+
+
+// formats and writes log records on a background thread - logging only moves the record into the
+// queue, so a slow sink never blocks the caller; records not fitting into the queue are dropped
+// and counted instead
+class AsyncLogger
+{
+public:
+    using Sink = std::function<void(QByteArray const&)>;
+
+    explicit AsyncLogger(size_t const aCapacity = 4096, Sink aSink = writeToStderr)
+        : queue(aCapacity)
+        , sink(std::move(aSink))
+        , writer([this]() { run(); })
+    {
+    }
+
+    ~AsyncLogger()
+    {
+        running.store(false, std::memory_order_release);
+        writer.join();
+    }
+
+    void log(LogRecord&& aRecord)
+    {
+        aRecord.timestamp = QDateTime::currentMSecsSinceEpoch();
+        if (!queue.tryPush(std::move(aRecord)))
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    quint64 droppedRecords() const
+    {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    // one line of logfmt: ts=... level=... event=... key=value ...
+    static QByteArray format(LogRecord const& aRecord)
+    {
+        static char const* const levels[] = {"debug", "warning", "critical", "fatal", "info"};
+
+        auto const quoted = [](QString const& aValue) {
+            auto value = aValue.toUtf8();
+            if (!value.isEmpty() && !value.contains(' ') && !value.contains('"')
+                && !value.contains('='))
+            {
+                return value;
+            }
+            return '"' + value.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n")
+                   + '"';
+        };
+
+        QByteArray line = "ts="
+                          + QDateTime::fromMSecsSinceEpoch(aRecord.timestamp, Qt::UTC)
+                                    .toString(Qt::ISODateWithMs)
+                                    .toLatin1()
+                          + " level=" + levels[aRecord.type] + " event=" + aRecord.event;
+        for (auto const& field : aRecord.fields)
+        {
+            line += ' ' + QByteArray(field.first) + '=' + quoted(field.second);
+        }
+
+        return line + '\n';
+    }
+
+    static void writeToStderr(QByteArray const& aLines)
+    {
+        (void) std::fwrite(aLines.constData(), 1, size_t(aLines.size()), stderr);
+        (void) std::fflush(stderr);
+    }
+
+private:
+    void run()
+    {
+        LogRecord record;
+        quint64 reportedDrops = 0;
+
+        for (;;)
+        {
+            // records logged until stopped are still written
+            auto const stopping = !running.load(std::memory_order_acquire);
+
+            QByteArray lines;
+            while (queue.tryPop(record))
+            {
+                lines += format(record);
+            }
+
+            if (auto const drops = droppedRecords(); drops != reportedDrops)
+            {
+                lines += format({QDateTime::currentMSecsSinceEpoch(),
+                                 QtWarningMsg,
+                                 "log_records_dropped",
+                                 {{"count", QString::number(drops - reportedDrops)}}});
+                reportedDrops = drops;
+            }
+
+            if (!lines.isEmpty())
+            {
+                sink(lines);
+            }
+            else if (stopping)
+            {
+                return;
+            }
+            else
+            {
+                // polling keeps the producers free of any wake-up call
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
+    }
+
+    RingBuffer<LogRecord> queue;
+    Sink const sink;
+
+    std::atomic<bool> running {true};
+    std::atomic<quint64> dropped {0};
+
+    // started last - after everything it uses
+    std::thread writer;
+};
+
+
+// token bucket per key: allows a burst of `aBurst` records, refilled by one every `aRefillMs` -
+// how many records were suppressed is told with the next one allowed. Not thread-safe, meant to
+// be used by the network thread only.
+class LogRateLimiter
+{
+public:
+    LogRateLimiter(int const aBurst, int const aRefillMs)
+        : burst(aBurst)
+        , refillMs(aRefillMs)
+    {
+    }
+
+    bool allow(QString const& aKey, int& aSuppressed)
+    {
+        auto const now = nowMs();
+
+        auto it = buckets.find(aKey);
+        if (it == buckets.end())
+        {
+            if (buckets.size() >= MaxKeys)
+            {
+                evictIdle(now);
+            }
+            it = buckets.insert(aKey, {double(burst), now, 0});
+        }
+
+        auto& bucket = *it;
+        bucket.tokens =
+                std::min(double(burst), bucket.tokens + double(now - bucket.last) / refillMs);
+        bucket.last = now;
+
+        if (bucket.tokens < 1.0)
+        {
+            ++bucket.suppressed;
+            return false;
+        }
+
+        bucket.tokens -= 1.0;
+        aSuppressed = std::exchange(bucket.suppressed, 0);
+        return true;
+    }
+
+private:
+    static constexpr int MaxKeys = 4096;
+
+    struct Bucket
+    {
+        double tokens;
+        qint64 last;
+        int suppressed;
+    };
+
+    static qint64 nowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+    }
+
+    // buckets refilled completely behave like new ones - and a storm of new keys resets all
+    void evictIdle(qint64 const aNow)
+    {
+        for (auto it = buckets.begin(); it != buckets.end();)
+        {
+            it = aNow - it->last >= qint64(burst) * refillMs ? buckets.erase(it) : std::next(it);
+        }
+
+        if (buckets.size() >= MaxKeys)
+        {
+            buckets.clear();
+        }
+    }
+
+    int const burst;
+    int const refillMs;
+    QHash<QString, Bucket> buckets;
+};
+
+
+AsyncLogger& asyncLog()
+{
+    static AsyncLogger logger;
+    return logger;
+}
+
+
+void logRecord(QtMsgType const type,
+               char const* event,
+               QVector<QPair<char const*, QString>> fields = {})
+{
+    asyncLog().log({0, type, event, std::move(fields)});
+}
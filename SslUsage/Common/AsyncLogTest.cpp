@@ -0,0 +1,178 @@
+#include "AsyncLogTest.h"
+
+#include "AsyncLog.h"
+
+#include <QThread>
+
+#include <thread>
+#include <vector>
+
+
+void AsyncLogTest::testThatConcurrentProducersNeitherLoseNorDuplicateRecords()
+{
+    // ARRANGE - a buffer far smaller than all the records, so producers hit it being full
+    constexpr quint64 Producers = 4;
+    constexpr quint64 RecordsEach = 100000;
+    RingBuffer<quint64> buffer(256);
+
+    // ACT - every producer pushes its id in the upper and a sequence in the lower half
+    std::vector<std::thread> producers;
+    for (quint64 p = 0; p < Producers; ++p)
+    {
+        producers.emplace_back([&buffer, p]() {
+            for (quint64 i = 0; i < RecordsEach; ++i)
+            {
+                while (!buffer.tryPush((p << 32) | i))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<quint64> next(Producers, 0);
+    quint64 received = 0;
+    quint64 value = 0;
+    while (received < Producers * RecordsEach)
+    {
+        if (!buffer.tryPop(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // ASSERT - each producer's records arrive in order - none missing, none twice
+        auto const producer = value >> 32;
+        QVERIFY(producer < Producers);
+        QCOMPARE(value & 0xffffffff, next[producer]);
+        ++next[producer];
+        ++received;
+    }
+
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+
+    // ASSERT - nothing left over
+    QVERIFY(!buffer.tryPop(value));
+    for (auto const count : next)
+    {
+        QCOMPARE(count, RecordsEach);
+    }
+}
+
+
+void AsyncLogTest::testThatAFullRingBufferRejectsPushes()
+{
+    RingBuffer<int> buffer(4);
+
+    // ACT + ASSERT - the 5th push fails until a record was popped
+    for (auto i = 0; i < 4; ++i)
+    {
+        QVERIFY(buffer.tryPush(int(i)));
+    }
+    QVERIFY(!buffer.tryPush(4));
+
+    auto value = -1;
+    QVERIFY(buffer.tryPop(value));
+    QCOMPARE(value, 0);
+    QVERIFY(buffer.tryPush(4));
+    QVERIFY(!buffer.tryPush(5));
+
+    // ASSERT - the rejected records are gone for good
+    for (auto i = 1; i <= 4; ++i)
+    {
+        QVERIFY(buffer.tryPop(value));
+        QCOMPARE(value, i);
+    }
+    QVERIFY(!buffer.tryPop(value));
+}
+
+
+void AsyncLogTest::testThatTheLoggerCountsAndReportsDroppedRecords()
+{
+    // ARRANGE - a sink stuck in writing the first record, while a queue of 2 fills up
+    std::atomic<bool> writing {false};
+    std::atomic<bool> released {false};
+    QByteArray written;
+
+    {
+        AsyncLogger logger(2, [&](QByteArray const& aLines) {
+            writing.store(true);
+            while (!released.load())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            written += aLines;
+        });
+
+        logger.log({0, QtInfoMsg, "first", {}});
+        QTRY_VERIFY(writing.load());
+
+        // ACT
+        for (auto i = 0; i < 5; ++i)
+        {
+            logger.log({0, QtInfoMsg, "queued", {{"i", QString::number(i)}}});
+        }
+
+        // ASSERT - 2 records fit, 3 are dropped w/o blocking the caller
+        QCOMPARE(logger.droppedRecords(), quint64(3));
+
+        // ACT - the logger writes everything queued when destroyed
+        released.store(true);
+    }
+
+    // ASSERT - the records queued are written, the ones dropped are reported
+    QVERIFY(written.contains("event=first"));
+    QVERIFY(written.contains("event=queued i=0\n"));
+    QVERIFY(written.contains("event=queued i=1\n"));
+    QVERIFY(!written.contains("event=queued i=2\n"));
+    QVERIFY(written.contains("level=warning event=log_records_dropped count=3\n"));
+}
+
+
+void AsyncLogTest::testThatTheLimiterAllowsABurstPerKey()
+{
+    // ARRANGE - no refill within the test
+    LogRateLimiter limiter(3, 60000);
+    auto suppressed = -1;
+
+    // ACT + ASSERT - the burst is allowed, anything beyond is suppressed
+    for (auto i = 0; i < 3; ++i)
+    {
+        QVERIFY(limiter.allow("a", suppressed));
+        QCOMPARE(suppressed, 0);
+    }
+    QVERIFY(!limiter.allow("a", suppressed));
+    QVERIFY(!limiter.allow("a", suppressed));
+
+    // ASSERT - other keys have their own bucket
+    QVERIFY(limiter.allow("b", suppressed));
+    QCOMPARE(suppressed, 0);
+}
+
+
+void AsyncLogTest::testThatTheLimiterRefillsAndTellsTheSuppressedRecords()
+{
+    // ARRANGE - a burst of 1, refilled every 50 ms
+    LogRateLimiter limiter(1, 50);
+    auto suppressed = -1;
+
+    QVERIFY(limiter.allow("a", suppressed));
+    for (auto i = 0; i < 3; ++i)
+    {
+        QVERIFY(!limiter.allow("a", suppressed));
+    }
+
+    // ACT - waiting for more than a refill - the bucket never holds more than the burst
+    QThread::msleep(120);
+
+    // ASSERT - the next record allowed tells how many were suppressed before, once
+    QVERIFY(limiter.allow("a", suppressed));
+    QCOMPARE(suppressed, 3);
+    QVERIFY(!limiter.allow("a", suppressed));
+}
+
+
+QTEST_MAIN(AsyncLogTest)
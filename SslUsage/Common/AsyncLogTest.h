@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QTest>
+
+
+class AsyncLogTest final : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    static void testThatConcurrentProducersNeitherLoseNorDuplicateRecords();
+    static void testThatAFullRingBufferRejectsPushes();
+    static void testThatTheLoggerCountsAndReportsDroppedRecords();
+    static void testThatTheLimiterAllowsABurstPerKey();
+    static void testThatTheLimiterRefillsAndTellsTheSuppressedRecords();
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+#include <algorithm>
+#include <functional>
+
+
+// simulates packet loss in-process: every datagram received is dropped with the given probability
+struct DropShim
+{
+    double probability = 0.0;
+
+    bool drop() const
+    {
+        return probability > 0.0 && QRandomGenerator::global()->generateDouble() < probability;
+    }
+};
+
+
+// sends `count` probes "<seq>\n" every `intervalMs` and measures the round trip time of each probe
+// echoed back - probes not echoed within a second after the last one was sent count as lost
+class LatencyProbe
+{
+public:
+    using Send = std::function<void(QByteArray const&)>;
+
+    LatencyProbe(int const aCount, int const aIntervalMs, Send aSend)
+        : count(aCount)
+        , send(std::move(aSend))
+    {
+        sendTimer.setInterval(aIntervalMs);
+        QObject::connect(&sendTimer, &QTimer::timeout, [this]() { sendNext(); });
+
+        timeout.setSingleShot(true);
+        timeout.setInterval(1000);
+    }
+
+    void start(std::function<void()> const& aDone)
+    {
+        QObject::connect(&timeout, &QTimer::timeout, aDone);
+
+        clock.start();
+        sendTimer.start();
+    }
+
+    void received(QByteArray const& aData)
+    {
+        // TCP may split or merge probes - so they are separated by line
+        pending += aData;
+        for (auto end = pending.indexOf('\n'); end >= 0; end = pending.indexOf('\n'))
+        {
+            auto ok = false;
+            auto const seq = pending.left(end).toInt(&ok);
+            pending.remove(0, end + 1);
+
+            if (ok && seq >= 0 && seq < sentAt.size() && sentAt[seq] >= 0)
+            {
+                rtts.append(clock.nsecsElapsed() - sentAt[seq]);
+                sentAt[seq] = -1;
+            }
+        }
+
+        if (rtts.size() == count)
+        {
+            sendTimer.stop();
+            timeout.start(0);
+        }
+    }
+
+    QString report() const
+    {
+        auto sorted = rtts;
+        std::sort(sorted.begin(), sorted.end());
+
+        auto const percentile = [&sorted](double const p) {
+            if (sorted.isEmpty())
+            {
+                return 0.0;
+            }
+            auto const i = std::min(sorted.size() - 1, int(p * sorted.size()));
+            return sorted[i] / 1000.0;
+        };
+
+        return QString("sent %1, received %2 (%3% lost) - RTT in us: "
+                       "p50 %4, p90 %5, p99 %6, p99.9 %7, max %8")
+                .arg(sentAt.size())
+                .arg(rtts.size())
+                .arg(100.0 * (sentAt.size() - rtts.size()) / std::max(1, sentAt.size()), 0, 'f', 2)
+                .arg(percentile(0.5), 0, 'f', 1)
+                .arg(percentile(0.9), 0, 'f', 1)
+                .arg(percentile(0.99), 0, 'f', 1)
+                .arg(percentile(0.999), 0, 'f', 1)
+                .arg(percentile(1.0), 0, 'f', 1);
+    }
+
+private:
+    void sendNext()
+    {
+        if (sentAt.size() == count)
+        {
+            sendTimer.stop();
+            timeout.start();
+            return;
+        }
+
+        sentAt.append(clock.nsecsElapsed());
+        send(QByteArray::number(sentAt.size() - 1) + '\n');
+    }
+
+    int const count;
+    Send const send;
+
+    QElapsedTimer clock;
+    QTimer sendTimer;
+    QTimer timeout;
+
+    // send time per sequence number, -1 once echoed
+    QVector<qint64> sentAt;
+    QVector<qint64> rtts;
+    QByteArray pending;
+};
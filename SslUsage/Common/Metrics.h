@@ -0,0 +1,198 @@
+#pragma once
+
+#include <QByteArray>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <limits>
+
+
+// all updates are single relaxed atomic operations - cheap enough for every read and write, and
+// safe to be read from any thread while being updated
+struct Counter
+{
+    std::atomic<quint64> value {0};
+
+    void add(quint64 const n = 1)
+    {
+        value.fetch_add(n, std::memory_order_relaxed);
+    }
+};
+
+
+struct Gauge
+{
+    std::atomic<qint64> value {0};
+
+    void add(qint64 const n)
+    {
+        value.fetch_add(n, std::memory_order_relaxed);
+    }
+};
+
+
+// bucket i counts the values < 2^i, the last bucket counts all values
+struct Histogram
+{
+    static constexpr int Buckets = 28;
+
+    std::array<std::atomic<quint64>, Buckets> buckets {};
+    std::atomic<quint64> count {0};
+    std::atomic<quint64> sum {0};
+
+    static int bucketOf(quint64 const value)
+    {
+        return std::min(Buckets - 1, 64 - int(qCountLeadingZeroBits(value)));
+    }
+
+    void observe(quint64 const value)
+    {
+        buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(value, std::memory_order_relaxed);
+    }
+};
+
+
+struct EchoMetrics
+{
+    Gauge activeConnections;
+    Counter connections;
+    Counter bytesIn;
+    Counter bytesOut;
+
+    Histogram handshakeMicros;
+    Histogram echoMicros;
+    Histogram writeBufferBytes;
+};
+
+
+// Prometheus text exposition format, version 0.0.4
+QByteArray toPrometheus(EchoMetrics const& m)
+{
+    QByteArray out;
+
+    auto const scalar = [&out](char const* name, char const* type, auto const& metric) {
+        out += QByteArray("# TYPE echo_") + name + ' ' + type + "\n";
+        out += QByteArray("echo_") + name + ' '
+               + QByteArray::number(metric.value.load(std::memory_order_relaxed)) + "\n";
+    };
+
+    auto const histogram = [&out](char const* name, Histogram const& h) {
+        out += QByteArray("# TYPE echo_") + name + " histogram\n";
+
+        // buckets are exposed cumulative, as Prometheus expects
+        quint64 cumulative = 0;
+        for (auto i = 0; i < Histogram::Buckets - 1; ++i)
+        {
+            cumulative += h.buckets[i].load(std::memory_order_relaxed);
+            out += QByteArray("echo_") + name + "_bucket{le=\""
+                   + QByteArray::number((quint64(1) << i) - 1) + "\"} "
+                   + QByteArray::number(cumulative) + "\n";
+        }
+
+        auto const count = h.count.load(std::memory_order_relaxed);
+        out += QByteArray("echo_") + name + "_bucket{le=\"+Inf\"} " + QByteArray::number(count)
+               + "\n";
+        out += QByteArray("echo_") + name + "_sum "
+               + QByteArray::number(h.sum.load(std::memory_order_relaxed)) + "\n";
+        out += QByteArray("echo_") + name + "_count " + QByteArray::number(count) + "\n";
+    };
+
+    scalar("active_connections", "gauge", m.activeConnections);
+    scalar("connections_total", "counter", m.connections);
+    scalar("received_bytes_total", "counter", m.bytesIn);
+    scalar("sent_bytes_total", "counter", m.bytesOut);
+    histogram("handshake_microseconds", m.handshakeMicros);
+    histogram("echo_microseconds", m.echoMicros);
+    histogram("write_buffer_bytes", m.writeBufferBytes);
+
+    return out;
+}
+
+
+void addMetricsOptions(QCommandLineParser& parser)
+{
+    (void) parser.addOption( //
+            {"metrics-port", "serve Prometheus metrics via HTTP on this port", "port"});
+    (void) parser.addOption( //
+            {"stats-interval", "dump the metrics every <seconds>", "seconds"});
+}
+
+
+// exposes the metrics as configured by the options of addMetricsOptions()
+void exposeMetrics(EchoMetrics const& m, QCommandLineParser const& parser, QObject* parent)
+{
+    if (parser.isSet("metrics-port"))
+    {
+        auto* const srv = new QTcpServer(parent);
+
+        // any request gets the metrics - it's not meant to be a web server
+        (void) QObject::connect(srv, &QTcpServer::newConnection, [srv, &m]() {
+            auto* const client = srv->nextPendingConnection();
+
+            (void) QObject::connect(client, &QTcpSocket::readyRead, [client, &m]() {
+                if (!client->peek(client->bytesAvailable()).contains("\r\n\r\n"))
+                {
+                    return;
+                }
+
+                auto const body = toPrometheus(m);
+                client->write("HTTP/1.0 200 OK\r\n"
+                              "Content-Type: text/plain; version=0.0.4\r\n"
+                              "Content-Length: "
+                              + QByteArray::number(body.size()) + "\r\n\r\n" + body);
+                client->disconnectFromHost();
+            });
+            (void) QObject::connect(
+                    client, &QTcpSocket::disconnected, client, &QObject::deleteLater);
+        });
+
+        auto const port = parser.value("metrics-port").toUShort();
+        if (!srv->listen(QHostAddress::LocalHost, port))
+        {
+            qCritical() << "unable to serve metrics on port" << port << "!";
+        }
+    }
+
+    if (parser.isSet("stats-interval"))
+    {
+        // a 0 ms timer would dump the metrics with every event loop pass
+        auto ok = false;
+        auto const seconds = parser.value("stats-interval").toInt(&ok);
+        if (!ok || seconds <= 0 || seconds > std::numeric_limits<int>::max() / 1000)
+        {
+            qCritical() << "invalid stats interval" << parser.value("stats-interval")
+                        << "- expecting seconds > 0!";
+            return;
+        }
+
+        auto* const timer = new QTimer(parent);
+        timer->setInterval(seconds * 1000);
+
+        (void) QObject::connect(timer, &QTimer::timeout, [&m]() {
+            auto const mean = [](Histogram const& h) {
+                auto const count = h.count.load(std::memory_order_relaxed);
+                return count > 0 ? h.sum.load(std::memory_order_relaxed) / count : 0;
+            };
+
+            qInfo().noquote() << QString("connections: %1 active, %2 total | bytes: %3 in, %4 out"
+                                         " | mean: handshake %5 us, echo %6 us, write buffer %7 B")
+                                         .arg(m.activeConnections.value.load())
+                                         .arg(m.connections.value.load())
+                                         .arg(m.bytesIn.value.load())
+                                         .arg(m.bytesOut.value.load())
+                                         .arg(mean(m.handshakeMicros))
+                                         .arg(mean(m.echoMicros))
+                                         .arg(mean(m.writeBufferBytes));
+        });
+        timer->start();
+    }
+}
@@ -0,0 +1,104 @@
+#include "LatencyProbe.h"
+#include "Shared.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDtls>
+#include <QUdpSocket>
+
+
+int main(int argc, char** argv)
+{
+    QCoreApplication const a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("DtlsEchoClient application");
+    (void) parser.addHelpOption();
+
+    (void) parser.addOption({{"p", "port"}, "port to send to", "port", "9878"});
+    (void) parser.addOption( //
+            {{"i", "host"}, "host to send to", "host", "127.0.0.1"});
+    (void) parser.addOption( //
+            {"name", "name expected in the server's certificate", "name", "server"});
+    (void) parser.addOption( //
+            {{"c", "cert"}, "Client certificate to use", "cert", ":/Certificate"});
+    (void) parser.addOption( //
+            {{"k", "key"}, "Client key to use", "key", ":/Key"});
+    (void) parser.addOption( //
+            {{"w", "pwd"}, "Key password to use", "pwd", "client_01"});
+    (void) parser.addOption({{"n", "count"}, "number of probes to send", "count", "1000"});
+    (void) parser.addOption( //
+            {"interval", "interval between probes in ms", "interval", "1"});
+    (void) parser.addOption( //
+            {"drop", "probability to drop a datagram received", "probability", "0"});
+    parser.process(QCoreApplication::arguments());
+
+    auto const host = QHostAddress(parser.value("host"));
+    auto const port = parser.value("port").toUShort();
+    DropShim const shim {parser.value("drop").toDouble()};
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////
+    // actual secure socket communication part - changes to UdpEchoClient
+    // 1. every datagram is passed through QDtls, which does the handshake first
+    // 2. lost handshake datagrams are re-sent by QDtls::handleTimeout()
+    QUdpSocket s;
+    QDtls dtls(QSslSocket::SslClientMode);
+    dtls.setDtlsConfiguration(dtlsConfigurationFor(
+            loadKey(parser.value("key"), parser.value("pwd").toUtf8()),
+            loadCert(parser.value("cert"))));
+    (void) dtls.setPeer(host, port, parser.value("name"));
+
+    LatencyProbe probe(
+            parser.value("count").toInt(), parser.value("interval").toInt(), [&](auto const& data) {
+                (void) dtls.writeDatagramEncrypted(&s, data);
+            });
+
+    QObject::connect(&dtls, &QDtls::handshakeTimeout, [&]() { (void) dtls.handleTimeout(&s); });
+    QObject::connect(&s, &QUdpSocket::connected, [&]() { (void) dtls.doHandshake(&s); });
+
+    QObject::connect(&s, &QUdpSocket::readyRead, [&]() {
+        while (s.hasPendingDatagrams())
+        {
+            QByteArray datagram(int(s.pendingDatagramSize()), Qt::Uninitialized);
+            auto const size = s.readDatagram(datagram.data(), datagram.size());
+            if (size < 0 || shim.drop())
+            {
+                continue;
+            }
+            datagram.resize(int(size));
+
+            if (dtls.isConnectionEncrypted())
+            {
+                probe.received(dtls.decryptDatagram(&s, datagram));
+            }
+            else if (!dtls.doHandshake(&s, datagram)
+                     || dtls.handshakeState() == QDtls::PeerVerificationFailed)
+            {
+                qCritical() << "unable to connect securely:" << dtls.dtlsErrorString();
+                for (auto const& error : dtls.peerVerificationErrors())
+                {
+                    qCritical() << error.errorString();
+                }
+                QCoreApplication::exit(1);
+            }
+            else if (dtls.isConnectionEncrypted())
+            {
+                qInfo() << "we have secure communication";
+                qDebug() << "session cipher" << dtls.sessionCipher();
+
+                probe.start([&]() {
+                    qInfo().noquote() << probe.report();
+                    (void) dtls.shutdown(&s);
+                    QCoreApplication::quit();
+                });
+            }
+        }
+    });
+
+    qInfo() << "connecting to" << host << ":" << port << "...";
+    s.connectToHost(host, port);
+    ///////////////////////////////////////////////////////////////////////////////////////////////
+
+    return QCoreApplication::exec();
+}
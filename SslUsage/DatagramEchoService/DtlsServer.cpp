@@ -0,0 +1,238 @@
+#include "LatencyProbe.h"
+#include "Shared.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDtls>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QNetworkDatagram>
+#include <QStringList>
+#include <QTimer>
+#include <QUdpSocket>
+
+
+namespace
+{
+struct DtlsServer final
+{
+    QUdpSocket socket;
+    QSslConfiguration config;
+    QDtlsClientVerifier verifier;
+    DropShim shim;
+
+    // one DTLS association per peer - all sharing the same socket
+    struct Peer
+    {
+        QDtls* dtls;
+        qint64 lastSeen;
+    };
+    QHash<QString, Peer> peers;
+
+    // a peer gone w/o its close_notify arriving is removed once idle for too long
+    QElapsedTimer clock;
+    QTimer sweep;
+    qint64 idleTimeoutMs = 0;
+
+    // handshake failure storms repeat the same errors over and over - per peer and errors, only a
+    // burst of 3 records is logged, then one a minute - just like dumpSslErrors() does
+    LogRateLimiter failures {3, 60 * 1000};
+
+    explicit DtlsServer(QCommandLineParser const& parser)
+    {
+        config = dtlsConfigurationFor(loadKey(parser.value("key"), parser.value("pwd").toUtf8()),
+                                      loadCert(parser.value("cert")));
+        shim.probability = parser.value("drop").toDouble();
+
+        QObject::connect(&socket, &QUdpSocket::readyRead, [this]() { readDatagrams(); });
+
+        clock.start();
+        idleTimeoutMs = std::max(1, parser.value("idle-timeout").toInt()) * 1000;
+        sweep.setInterval(int(std::max<qint64>(1000, idleTimeoutMs / 4)));
+        QObject::connect(&sweep, &QTimer::timeout, [this]() { removeIdlePeers(); });
+        sweep.start();
+    }
+
+    void readDatagrams()
+    {
+        while (socket.hasPendingDatagrams())
+        {
+            auto const datagram = socket.receiveDatagram();
+            if (shim.drop())
+            {
+                continue;
+            }
+
+            auto const address = datagram.senderAddress();
+            auto const port = quint16(datagram.senderPort());
+            auto const peer = QString("%1:%2").arg(address.toString()).arg(port);
+
+            if (auto const it = peers.find(peer); it != peers.end())
+            {
+                it->lastSeen = clock.elapsed();
+                handle(peer, it->dtls, datagram.data());
+                continue;
+            }
+
+            // the cookie exchange proves the peer owns its address - before any state is kept
+            if (!verifier.verifyClient(&socket, datagram.data(), address, port))
+            {
+                if (verifier.dtlsError() != QDtlsError::NoError)
+                {
+                    logFailure(QtWarningMsg,
+                               "cookie_verification_failed",
+                               address,
+                               verifier.dtlsErrorString());
+                }
+                continue;
+            }
+
+            auto* const dtls = new QDtls(QSslSocket::SslServerMode, &socket);
+            dtls->setDtlsConfiguration(config);
+            (void) dtls->setPeer(address, port);
+            QObject::connect(dtls, &QDtls::handshakeTimeout, [this, dtls]() {
+                (void) dtls->handleTimeout(&socket);
+            });
+
+            peers.insert(peer, {dtls, clock.elapsed()});
+            handle(peer, dtls, datagram.data());
+        }
+    }
+
+    void handle(QString const& peer, QDtls* const dtls, QByteArray const& data)
+    {
+        if (dtls->isConnectionEncrypted())
+        {
+            auto const message = dtls->decryptDatagram(&socket, data);
+            if (dtls->dtlsError() == QDtlsError::RemoteClosedConnectionError)
+            {
+                logRecord(QtDebugMsg, "client_disconnected", {{"peer", peer}});
+                remove(peer);
+            }
+            else if (!message.isEmpty())
+            {
+                (void) dtls->writeDatagramEncrypted(&socket, message);
+            }
+            return;
+        }
+
+        if (!dtls->doHandshake(&socket, data))
+        {
+            logFailure(QtWarningMsg,
+                       "handshake_failed",
+                       dtls->peerAddress(),
+                       dtls->dtlsErrorString());
+            remove(peer);
+        }
+        else if (dtls->handshakeState() == QDtls::PeerVerificationFailed)
+        {
+            QStringList errors;
+            for (auto const& error : dtls->peerVerificationErrors())
+            {
+                errors << error.errorString();
+            }
+            logFailure(QtCriticalMsg, "ssl_errors", dtls->peerAddress(), errors.join("; "));
+
+            (void) dtls->abortHandshake(&socket);
+            remove(peer);
+        }
+        else if (dtls->isConnectionEncrypted())
+        {
+            logRecord(QtDebugMsg,
+                      "client_connected",
+                      {{"peer", peer}, {"cipher", dtls->sessionCipher().name()}});
+        }
+    }
+
+    // logged on the writer thread of the AsyncLogger, never blocking the network thread
+    void logFailure(QtMsgType const type,
+                    char const* event,
+                    QHostAddress const& address,
+                    QString const& errors)
+    {
+        auto suppressed = 0;
+        if (!failures.allow(address.toString() + ' ' + event + ' ' + errors, suppressed))
+        {
+            return;
+        }
+
+        logRecord(type,
+                  event,
+                  {{"peer", address.toString()},
+                   {"errors", errors},
+                   {"suppressed", QString::number(suppressed)}});
+    }
+
+    void remove(QString const& peer)
+    {
+        if (auto const it = peers.find(peer); it != peers.end())
+        {
+            it->dtls->deleteLater();
+            peers.erase(it);
+        }
+    }
+
+    void removeIdlePeers()
+    {
+        auto const now = clock.elapsed();
+        for (auto it = peers.begin(); it != peers.end();)
+        {
+            if (now - it->lastSeen < idleTimeoutMs)
+            {
+                ++it;
+                continue;
+            }
+
+            logRecord(QtDebugMsg, "client_idle", {{"peer", it.key()}});
+            it->dtls->deleteLater();
+            it = peers.erase(it);
+        }
+    }
+};
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("DtlsEchoServer application");
+    (void) parser.addHelpOption();
+
+    (void) parser.addOption({{"p", "port"}, "port to listen to", "port", "9878"});
+    (void) parser.addOption( //
+            {{"i", "interface"}, "interface to listen to", "interface", "127.0.0.1"});
+    (void) parser.addOption( //
+            {{"c", "cert"}, "Client certificate to use", "cert", ":/Certificate"});
+    (void) parser.addOption( //
+            {{"k", "key"}, "Client key to use", "key", ":/Key"});
+    (void) parser.addOption( //
+            {{"w", "pwd"}, "Key password to use", "pwd", "server"});
+    (void) parser.addOption( //
+            {"drop", "probability to drop a datagram received", "probability", "0"});
+    (void) parser.addOption( //
+            {"idle-timeout", "remove peers silent for <seconds>", "seconds", "60"});
+    parser.process(QCoreApplication::arguments());
+
+    auto const interface = QHostAddress(parser.value("interface"));
+    auto const port = parser.value("port").toUShort();
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////
+    // actual socket communication part - same as for UdpEchoServer, only each peer is handled by
+    // its own QDtls, once it passed the cookie verification
+    DtlsServer srv(parser);
+
+    if (!srv.socket.bind(interface, port))
+    {
+        qCritical() << "unable to bind to" << interface << ":" << port << "!";
+        return 1;
+    }
+
+    qDebug() << "dtls echo server listening on" << interface << ":" << port << "!";
+    return QCoreApplication::exec();
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,64 @@
+#include "LatencyProbe.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QNetworkDatagram>
+#include <QUdpSocket>
+
+
+int main(int argc, char** argv)
+{
+    QCoreApplication const a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("UdpEchoClient application");
+    (void) parser.addHelpOption();
+
+    (void) parser.addOption({{"p", "port"}, "port to send to", "port", "9877"});
+    (void) parser.addOption( //
+            {{"i", "host"}, "host to send to", "host", "127.0.0.1"});
+    (void) parser.addOption({{"n", "count"}, "number of probes to send", "count", "1000"});
+    (void) parser.addOption( //
+            {"interval", "interval between probes in ms", "interval", "1"});
+    (void) parser.addOption( //
+            {"drop", "probability to drop a datagram received", "probability", "0"});
+    parser.process(QCoreApplication::arguments());
+
+    auto const host = QHostAddress(parser.value("host"));
+    auto const port = parser.value("port").toUShort();
+    DropShim const shim {parser.value("drop").toDouble()};
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////
+    // actual socket communication part - a lost datagram is lost, it does not delay later ones
+    QUdpSocket s;
+    LatencyProbe probe(parser.value("count").toInt(),
+                       parser.value("interval").toInt(),
+                       [&](QByteArray const& data) { (void) s.writeDatagram(data, host, port); });
+
+    QObject::connect(&s, &QUdpSocket::readyRead, [&]() {
+        while (s.hasPendingDatagrams())
+        {
+            auto const datagram = s.receiveDatagram();
+            if (!shim.drop())
+            {
+                probe.received(datagram.data());
+            }
+        }
+    });
+
+    if (!s.bind())
+    {
+        qCritical() << "unable to bind UDP socket!";
+        return 1;
+    }
+
+    probe.start([&probe]() {
+        qInfo().noquote() << probe.report();
+        QCoreApplication::quit();
+    });
+    ///////////////////////////////////////////////////////////////////////////////////////////////
+
+    return QCoreApplication::exec();
+}
@@ -0,0 +1,55 @@
+#include "LatencyProbe.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QNetworkDatagram>
+#include <QUdpSocket>
+
+
+int main(int argc, char** argv)
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("UdpEchoServer application");
+    (void) parser.addHelpOption();
+
+    (void) parser.addOption({{"p", "port"}, "port to listen to", "port", "9877"});
+    (void) parser.addOption( //
+            {{"i", "interface"}, "interface to listen to", "interface", "127.0.0.1"});
+    (void) parser.addOption( //
+            {"drop", "probability to drop a datagram received", "probability", "0"});
+    parser.process(QCoreApplication::arguments());
+
+    auto const interface = QHostAddress(parser.value("interface"));
+    auto const port = parser.value("port").toUShort();
+    DropShim const shim {parser.value("drop").toDouble()};
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////
+    // actual socket communication part - there are no connections, every datagram received is
+    // answered to its sender, so one socket serves any number of peers
+    QUdpSocket s;
+    QObject::connect(&s, &QUdpSocket::readyRead, [&s, &shim]() {
+        while (s.hasPendingDatagrams())
+        {
+            auto const datagram = s.receiveDatagram();
+            if (!shim.drop())
+            {
+                (void) s.writeDatagram(datagram.makeReply(datagram.data()));
+            }
+        }
+    });
+
+    if (!s.bind(interface, port))
+    {
+        qCritical() << "unable to bind to" << interface << ":" << port << "!";
+        return 1;
+    }
+
+    qDebug() << "udp echo server listening on" << interface << ":" << port << "!";
+    ///////////////////////////////////////////////////////////////////////////////////////////////
+
+    return a.exec();
+}
@@ -1,8 +1,12 @@
+#include "LatencyProbe.h"
+
 #include <QCommandLineParser>
 #include <QCoreApplication>
 #include <QDebug>
 #include <QTcpSocket>
 
+#include <memory>
+
 
 int main(int argc, char** argv)
 {
@@ -15,6 +19,10 @@ int main(int argc, char** argv)
     (void) parser.addOption({{"p", "port"}, "port to connect to", "port", "9876"});
     (void) parser.addOption( //
             {{"i", "host"}, "host to connect to", "host", "127.0.0.1"});
+    (void) parser.addOption( //
+            {"latency", "measure the round trip time of <count> probes", "count"});
+    (void) parser.addOption( //
+            {"interval", "interval between probes in ms", "interval", "1"});
     parser.process(QCoreApplication::arguments());
 
     auto const host = parser.value("host");
@@ -24,9 +32,37 @@ int main(int argc, char** argv)
     ///////////////////////////////////////////////////////////////////////////////////////////////
     // actual socket communication part
     QTcpSocket s;
-    QObject::connect(&s, &QTcpSocket::connected, [&s]() { s.write("hello from client!"); });
-    QObject::connect(&s, &QTcpSocket::readyRead, [&s, &a]() {
+
+    // optionally measure the round trip time of many small messages - to compare with UDP
+    std::unique_ptr<LatencyProbe> probe;
+    if (parser.isSet("latency"))
+    {
+        probe = std::make_unique<LatencyProbe>(parser.value("latency").toInt(),
+                                               parser.value("interval").toInt(),
+                                               [&s](QByteArray const& data) { s.write(data); });
+    }
+
+    QObject::connect(&s, &QTcpSocket::connected, [&s, &probe]() {
+        if (!probe)
+        {
+            s.write("hello from client!");
+            return;
+        }
+
+        s.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        probe->start([&probe]() {
+            qInfo().noquote() << probe->report();
+            QCoreApplication::quit();
+        });
+    });
+    QObject::connect(&s, &QTcpSocket::readyRead, [&s, &probe]() {
         auto const data = s.readAll();
+        if (probe)
+        {
+            probe->received(data);
+            return;
+        }
+
         qDebug() << "received: " << data;
         QCoreApplication::quit();
     });
@@ -1,9 +1,24 @@
+#include "AsyncLog.h"
+#include "Metrics.h"
+
 #include <QCommandLineParser>
 #include <QCoreApplication>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
 #include <QTcpServer>
 #include <QTcpSocket>
 
+#include <memory>
+
+
+namespace
+{
+// per-message logging is off by default - enable with QT_LOGGING_RULES="echo.traffic.debug=true"
+Q_LOGGING_CATEGORY(traffic, "echo.traffic", QtInfoMsg)
+
+} // namespace
+
 
 int main(int argc, char** argv)
 {
@@ -16,6 +31,7 @@ int main(int argc, char** argv)
     (void) parser.addOption({{"p", "port"}, "port to listen to", "port", "9876"});
     (void) parser.addOption( //
             {{"i", "interface"}, "interface to listen to", "interface", "127.0.0.1"});
+    addMetricsOptions(parser);
     parser.process(QCoreApplication::arguments());
 
     auto const interface = QHostAddress(parser.value("interface"));
@@ -25,23 +41,51 @@ int main(int argc, char** argv)
     ///////////////////////////////////////////////////////////////////////////////////////////////
     // actual socket communication part
     QTcpServer srv;
-    QObject::connect(&srv, &QTcpServer::newConnection, [&srv]() {
+    EchoMetrics metrics;
+    exposeMetrics(metrics, parser, &srv);
+
+    QObject::connect(&srv, &QTcpServer::newConnection, [&srv, &metrics]() {
         auto* const client = srv.nextPendingConnection();
-        qDebug() << "new client connected from" << //
-                client->peerAddress().toString() << ":" << client->peerPort();
+        auto const peer =
+                client->peerAddress().toString() + ':' + QString::number(client->peerPort());
+        logRecord(QtDebugMsg, "client_connected", {{"peer", peer}});
+
+        metrics.connections.add();
+        metrics.activeConnections.add(1);
 
+        // echo every message right away, instead of waiting to coalesce small ones
+        client->setSocketOption(QAbstractSocket::LowDelayOption, 1);
         client->write("Welcome to RawEchoServer!\n");
 
-        (void) QObject::connect(client, &QTcpSocket::readyRead, [client]() { //
+        // echo latency is measured from reading a message until it was handed to the OS completely
+        auto const echoing = std::make_shared<QElapsedTimer>();
+
+        (void) QObject::connect(client, &QTcpSocket::readyRead, [client, echoing, &metrics]() {
             auto const& data = client->readAll();
-            qDebug() << "received: " << data;
+            qCDebug(traffic) << "received: " << data;
 
+            if (!echoing->isValid())
+            {
+                echoing->start();
+            }
+            metrics.bytesIn.add(data.size());
             client->write(data);
+            metrics.writeBufferBytes.observe(client->bytesToWrite());
         });
 
-        (void) QObject::connect(client, &QTcpSocket::disconnected, [client]() {
-            qDebug() << "client from" << //
-                    client->peerAddress().toString() << ":" << client->peerPort() << "disconnected";
+        (void) QObject::connect(
+                client, &QTcpSocket::bytesWritten, [client, echoing, &metrics](qint64 const n) {
+                    metrics.bytesOut.add(n);
+                    if (client->bytesToWrite() == 0 && echoing->isValid())
+                    {
+                        metrics.echoMicros.observe(echoing->nsecsElapsed() / 1000);
+                        echoing->invalidate();
+                    }
+                });
+
+        (void) QObject::connect(client, &QTcpSocket::disconnected, [peer, &metrics]() {
+            metrics.activeConnections.add(-1);
+            logRecord(QtDebugMsg, "client_disconnected", {{"peer", peer}});
         });
     });
 
@@ -1,10 +1,59 @@
+#include "LatencyProbe.h"
 #include "Shared.h"
 
 #include <QCommandLineParser>
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QSslCipher>
 #include <QTcpSocket>
 
+#include <ctime>
+#include <functional>
+#include <memory>
+
+
+namespace
+{
+// sequential full handshakes - each on a fresh socket, so no session is resumed
+int benchmarkHandshakes(QString const& host,
+                        quint16 const port,
+                        int const count,
+                        std::function<void(QSslSocket&)> const& setup)
+{
+    QElapsedTimer wall;
+    wall.start();
+    auto const cpuStart = std::clock();
+
+    auto succeeded = 0;
+    for (auto i = 0; i < count; ++i)
+    {
+        QSslSocket s;
+        setup(s);
+
+        s.connectToHostEncrypted(host, port);
+        if (s.waitForEncrypted(5000))
+        {
+            ++succeeded;
+        }
+
+        s.disconnectFromHost();
+        if (s.state() != QAbstractSocket::UnconnectedState)
+        {
+            (void) s.waitForDisconnected(1000);
+        }
+    }
+
+    auto const wallMs = std::max<qint64>(1, wall.elapsed());
+    auto const cpuMs = 1000.0 * double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+    qInfo() << succeeded << "of" << count << "handshakes in" << wallMs << "ms:" //
+            << 1000.0 * succeeded / wallMs << "handshakes/s," //
+            << cpuMs / std::max(1, succeeded) << "ms client CPU per handshake";
+    return succeeded == count ? 0 : 1;
+}
+
+} // namespace
+
 
 int main(int argc, char** argv)
 {
@@ -23,6 +72,16 @@ int main(int argc, char** argv)
             {{"k", "key"}, "Client key to use", "key", ":/Key"});
     (void) parser.addOption( //
             {{"w", "pwd"}, "Key password to use", "pwd", "client_01"});
+    (void) parser.addOption( //
+            {"psk", "use a PSK instead of certificates", "<identity>:<secret>"});
+    (void) parser.addOption( //
+            {"pbkdf2", "PBKDF2 iterations to derive the PSK from the secret", "iterations", "0"});
+    (void) parser.addOption( //
+            {"bench", "benchmark <count> handshakes instead of echoing", "count"});
+    (void) parser.addOption( //
+            {"latency", "measure the round trip time of <count> probes", "count"});
+    (void) parser.addOption( //
+            {"interval", "interval between probes in ms", "interval", "1"});
 
     parser.process(QCoreApplication::arguments());
 
@@ -42,15 +101,67 @@ int main(int argc, char** argv)
     //    b) OR use the signal encrypted() if you want to continue already and wait
     //       for secure connection asynchronously -QSslSocket has some internal buffering,
     //       you can even send already...
+    // 4. alternatively authenticate with a PSK, looked up by the server for our identity - this
+    //    skips all certificate crypto in the handshake
+    auto const usePsk = parser.isSet("psk");
+    auto const pskIdentity = parser.value("psk").section(':', 0, 0).toUtf8();
+    auto const psk = derivePsk(pskIdentity,
+                               parser.value("psk").section(':', 1).toUtf8(),
+                               parser.value("pbkdf2").toInt());
+
+    QSslKey key;
+    QSslCertificate cert;
+    if (!usePsk)
+    {
+        key = loadKey(keyFileName, "client_01");
+        cert = loadCert(certFileName);
+    }
+
+    auto const setup = [&](QSslSocket& socket) {
+        if (!usePsk)
+        {
+            setupSslConfigurationFor(socket, key, cert);
+            return;
+        }
+
+        setupPskConfigurationFor(socket);
+        QObject::connect(&socket,
+                         &QSslSocket::preSharedKeyAuthenticationRequired,
+                         [&](QSslPreSharedKeyAuthenticator* authenticator) {
+                             authenticator->setIdentity(pskIdentity);
+                             authenticator->setPreSharedKey(psk);
+                         });
+    };
+
+    if (parser.isSet("bench"))
+    {
+        return benchmarkHandshakes(host, port, parser.value("bench").toInt(), setup);
+    }
+
     QSslSocket s;
-    setupSslConfigurationFor(s, loadKey(keyFileName, "client_01"), loadCert(certFileName));
+    setup(s);
 
     QObject::connect(&s, QOverload<SslErrs>::of(&QSslSocket::sslErrors), [&s](SslErrs errors) {
         dumpSslErrors(errors, s);
     });
 
-    QObject::connect(&s, &QTcpSocket::readyRead, [&s, &a]() {
+    // optionally measure the round trip time of many small messages - to compare with DTLS
+    std::unique_ptr<LatencyProbe> probe;
+    if (parser.isSet("latency"))
+    {
+        probe = std::make_unique<LatencyProbe>(parser.value("latency").toInt(),
+                                               parser.value("interval").toInt(),
+                                               [&s](QByteArray const& data) { s.write(data); });
+    }
+
+    QObject::connect(&s, &QTcpSocket::readyRead, [&s, &probe]() {
         auto const data = s.readAll();
+        if (probe)
+        {
+            probe->received(data);
+            return;
+        }
+
         qDebug() << "received: " << data;
         QCoreApplication::quit();
     });
@@ -62,7 +173,18 @@ int main(int argc, char** argv)
         qInfo() << "we have secure communication";
         qDebug() << "session cipher" << s.sessionCipher();
 
-        s.write("hello from secure client!");
+        if (probe)
+        {
+            s.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+            probe->start([&probe]() {
+                qInfo().noquote() << probe->report();
+                QCoreApplication::quit();
+            });
+        }
+        else
+        {
+            s.write("hello from secure client!");
+        }
     }
     else
     {
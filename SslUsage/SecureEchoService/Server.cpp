@@ -1,22 +1,43 @@
+#include "Metrics.h"
 #include "Shared.h"
 
 #include <QCommandLineParser>
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
 #include <QTcpServer>
 #include <QTcpSocket>
 
+#include <memory>
+
 
 namespace
 {
+// per-message logging is off by default - enable with QT_LOGGING_RULES="echo.traffic.debug=true"
+Q_LOGGING_CATEGORY(traffic, "echo.traffic", QtInfoMsg)
+
 struct SecureServer final : QTcpServer
 {
     QSslKey key;
     QSslCertificate cert;
 
-    explicit SecureServer(QCommandLineParser const& parser)
+    // PSK mode, if identities were given - no certificates are used then
+    bool const pskMode;
+    PskTable psk;
+
+    EchoMetrics metrics;
+
+    explicit SecureServer(QCommandLineParser const& parser) : pskMode(parser.isSet("psk"))
     {
-        key = loadKey(parser.value("key"), parser.value("pwd").toUtf8());
-        cert = loadCert(parser.value("cert"));
+        if (pskMode)
+        {
+            psk = loadPskTable(parser.value("psk"), parser.value("pbkdf2").toInt());
+        }
+        else
+        {
+            key = loadKey(parser.value("key"), parser.value("pwd").toUtf8());
+            cert = loadCert(parser.value("cert"));
+        }
     }
 
     void incomingConnection(qintptr const aSocketDescriptor) override
@@ -25,12 +46,37 @@ struct SecureServer final : QTcpServer
 
         if (sslSocket->setSocketDescriptor(aSocketDescriptor))
         {
+            // handshake time is measured from accepting the connection until it is encrypted
+            QElapsedTimer handshake;
+            handshake.start();
+            connect(sslSocket, &QSslSocket::encrypted, [this, handshake]() {
+                metrics.handshakeMicros.observe(handshake.nsecsElapsed() / 1000);
+            });
+
             connect(sslSocket, QOverload<SslErrs>::of(&QSslSocket::sslErrors), [&](SslErrs errors) {
                 dumpSslErrors(errors, *sslSocket);
             });
             addPendingConnection(sslSocket);
 
-            setupSslConfigurationFor(*sslSocket, key, cert);
+            if (!pskMode)
+            {
+                setupSslConfigurationFor(*sslSocket, key, cert);
+            }
+            else
+            {
+                setupPskConfigurationFor(*sslSocket);
+
+                // an unknown identity gets no key - and hence fails the handshake
+                connect(sslSocket,
+                        &QSslSocket::preSharedKeyAuthenticationRequired,
+                        [this](QSslPreSharedKeyAuthenticator* authenticator) {
+                            if (auto const it = psk.constFind(authenticator->identity());
+                                it != psk.constEnd())
+                            {
+                                authenticator->setPreSharedKey(*it);
+                            }
+                        });
+            }
 
             sslSocket->startServerEncryption();
         }
@@ -61,6 +107,11 @@ int main(int argc, char** argv)
             {{"k", "key"}, "Client key to use", "key", ":/Key"});
     (void) parser.addOption( //
             {{"w", "pwd"}, "Key password to use", "pwd", "server"});
+    (void) parser.addOption( //
+            {"psk", "use PSKs instead of certificates", "<identity>:<secret>,..."});
+    (void) parser.addOption( //
+            {"pbkdf2", "PBKDF2 iterations to derive PSKs from secrets", "iterations", "0"});
+    addMetricsOptions(parser);
     parser.process(QCoreApplication::arguments());
 
     auto const interface = QHostAddress(parser.value("interface"));
@@ -70,24 +121,57 @@ int main(int argc, char** argv)
     ///////////////////////////////////////////////////////////////////////////////////////////////
     // actual socket communication part - same as for RawEchoServer, only using SecureServer
     SecureServer srv(parser);
+    if (srv.pskMode && srv.psk.isEmpty())
+    {
+        qCritical() << "no valid PSK given - refusing to start w/o any key to accept";
+        return 1;
+    }
+
+    auto& metrics = srv.metrics;
+    exposeMetrics(metrics, parser, &srv);
 
-    (void) QObject::connect(&srv, &QTcpServer::newConnection, [&srv]() {
+    (void) QObject::connect(&srv, &QTcpServer::newConnection, [&srv, &metrics]() {
         auto* const client = srv.nextPendingConnection();
-        qDebug() << "new client connected from" << //
-                client->peerAddress().toString() << ":" << client->peerPort();
+        auto const peer =
+                client->peerAddress().toString() + ':' + QString::number(client->peerPort());
+        logRecord(QtDebugMsg, "client_connected", {{"peer", peer}});
 
+        metrics.connections.add();
+        metrics.activeConnections.add(1);
+
+        // echo every message right away, instead of waiting to coalesce small ones
+        client->setSocketOption(QAbstractSocket::LowDelayOption, 1);
         client->write("Welcome to SecureEchoServer!\n");
 
-        (void) QObject::connect(client, &QTcpSocket::readyRead, [client]() {
+        // echo latency is measured from reading a message until it was handed to the OS completely
+        auto const echoing = std::make_shared<QElapsedTimer>();
+
+        (void) QObject::connect(client, &QTcpSocket::readyRead, [client, echoing, &metrics]() {
             auto const& data = client->readAll();
-            qDebug() << "echoing back: " << data;
+            qCDebug(traffic) << "echoing back: " << data;
 
+            if (!echoing->isValid())
+            {
+                echoing->start();
+            }
+            metrics.bytesIn.add(data.size());
             client->write(data);
+            metrics.writeBufferBytes.observe(client->bytesToWrite());
         });
 
-        (void) QObject::connect(client, &QTcpSocket::disconnected, [client]() {
-            qDebug() << "client from" << //
-                    client->peerAddress().toString() << ":" << client->peerPort() << "disconnected";
+        (void) QObject::connect(
+                client, &QTcpSocket::bytesWritten, [client, echoing, &metrics](qint64 const n) {
+                    metrics.bytesOut.add(n);
+                    if (client->bytesToWrite() == 0 && echoing->isValid())
+                    {
+                        metrics.echoMicros.observe(echoing->nsecsElapsed() / 1000);
+                        echoing->invalidate();
+                    }
+                });
+
+        (void) QObject::connect(client, &QTcpSocket::disconnected, [peer, &metrics]() {
+            metrics.activeConnections.add(-1);
+            logRecord(QtDebugMsg, "client_disconnected", {{"peer", peer}});
         });
     });
 
@@ -1,12 +1,19 @@
 #pragma once
 
+#include "AsyncLog.h"
+#include "BackportedQPasswordDigestor.h"
+
 #include <QDebug>
 #include <QFile>
+#include <QHash>
 #include <QSslCertificate>
+#include <QSslCipher>
 #include <QSslConfiguration>
 #include <QSslKey>
+#include <QSslPreSharedKeyAuthenticator>
 #include <QSslSocket>
 #include <QString>
+#include <QStringList>
 
 #include <algorithm>
 #include <stdexcept>
@@ -28,8 +35,13 @@ QByteArray readFromQrc(QString const& aFileName)
 QSslKey loadKey(QString const& aFileName, QByteArray const& pwd)
 {
     auto const key = QSslKey(readFromQrc(aFileName), QSsl::Rsa, QSsl::Pem, QSsl::PrivateKey, pwd);
-    qDebug() << "error loading key?" << key.isNull();
-    qInfo() << "Loaded key: " << key;
+
+    // never log the key itself - only which one was loaded
+    logRecord(key.isNull() ? QtCriticalMsg : QtInfoMsg,
+              "key_loaded",
+              {{"file", aFileName},
+               {"valid", key.isNull() ? "false" : "true"},
+               {"bits", QString::number(key.length())}});
 
     return key;
 }
@@ -38,8 +50,13 @@ QSslKey loadKey(QString const& aFileName, QByteArray const& pwd)
 QSslCertificate loadCert(QString const& aFileName)
 {
     auto const cert = QSslCertificate(readFromQrc(aFileName), QSsl::Pem);
-    qDebug() << "error loading cert?" << cert.isNull();
-    qInfo() << "Loaded certificate: " << cert;
+    logRecord(cert.isNull() ? QtCriticalMsg : QtInfoMsg,
+              "certificate_loaded",
+              {{"file", aFileName},
+               {"valid", cert.isNull() ? "false" : "true"},
+               {"subject_cn", cert.subjectInfo(QSslCertificate::CommonName).join(' ')},
+               {"sha256", cert.digest(QCryptographicHash::Sha256).toHex()},
+               {"expires", cert.expiryDate().toString(Qt::ISODate)}});
 
     return cert;
 }
@@ -68,31 +85,139 @@ void setupSslConfigurationFor(QSslSocket& s, QSslKey const& key, QSslCertificate
 }
 
 
+QSslConfiguration dtlsConfigurationFor(QSslKey const& key, QSslCertificate const& cert)
+{
+    // same as setupSslConfigurationFor() - only for datagrams, which TLS v1.3 doesn't cover
+    auto sslConfig = QSslConfiguration::defaultDtlsConfiguration();
+    {
+        sslConfig.setProtocol(QSsl::DtlsV1_2OrLater);
+        sslConfig.setCaCertificates({QSslCertificate(readFromQrc(":/CA"), QSsl::Pem)});
+        sslConfig.setPrivateKey(key);
+        sslConfig.setLocalCertificate(cert);
+        sslConfig.setPeerVerifyMode(QSslSocket::VerifyPeer);
+    }
+    return sslConfig;
+}
+
+
+// PSK identities and their pre-shared keys
+using PskTable = QHash<QByteArray, QByteArray>;
+
+
+QByteArray derivePsk(QByteArray const& identity, QByteArray const& secret, int const iterations)
+{
+    // w/o iterations the secret is used as key directly, otherwise the key is derived from it w/
+    // PBKDF2 - salted with the identity, so two identities sharing a secret get different keys
+    if (iterations <= 0)
+    {
+        return secret;
+    }
+
+    return BackportedQt::deriveKeyPbkdf2(
+            QCryptographicHash::Sha256, secret, identity, iterations, 32);
+}
+
+
+PskTable loadPskTable(QString const& entries, int const iterations)
+{
+    // entries are given as "<identity>:<secret>,<identity>:<secret>,..."
+    PskTable table;
+    for (auto const& entry : entries.split(',', Qt::SkipEmptyParts))
+    {
+        auto const identity = entry.section(':', 0, 0).toUtf8();
+        auto const secret = entry.section(':', 1).toUtf8();
+        if (identity.isEmpty() || secret.isEmpty())
+        {
+            qCritical() << "invalid PSK entry, expected <identity>:<secret>:" << entry;
+            continue;
+        }
+
+        // derived once up front - the handshake only looks the key up
+        table.insert(identity, derivePsk(identity, secret, iterations));
+    }
+
+    QStringList identities;
+    for (auto const& identity : table.keys())
+    {
+        identities << QString::fromUtf8(identity);
+    }
+    logRecord(QtInfoMsg, "psks_loaded", {{"identities", identities.join(',')}});
+    return table;
+}
+
+
+void setupPskConfigurationFor(QSslSocket& s)
+{
+    auto sslConfig = s.sslConfiguration();
+    {
+        // TLS v1.2 - Qt 5's OpenSSL backend doesn't offer a PSK from a client using TLS v1.3, so
+        // a server w/o certificate could never complete a TLS v1.3 handshake
+        sslConfig.setProtocol(QSsl::TlsV1_2);
+
+        // only PSK cipher suites, which need no certificate at all
+        QList<QSslCipher> ciphers;
+        for (auto const* const name : {"PSK-AES256-GCM-SHA384", "PSK-AES128-GCM-SHA256"})
+        {
+            if (QSslCipher const cipher(name); !cipher.isNull())
+            {
+                ciphers << cipher;
+            }
+        }
+        sslConfig.setCiphers(ciphers);
+
+        // no certificates involved - both peers authenticate by proving they know the same key,
+        // answered in QSslSocket::preSharedKeyAuthenticationRequired
+        sslConfig.setPeerVerifyMode(QSslSocket::VerifyNone);
+    }
+    s.setSslConfiguration(sslConfig);
+}
+
+
 void dumpCert(QSslCertificate const& cert)
 {
-    qDebug() << "---";
-    qDebug() << "digest: " << cert.digest().toHex();
-    qDebug() << "serial: " << cert.serialNumber().toHex();
-    qDebug() << "---subject";
-    qDebug() << "CN: " << cert.subjectInfo(QSslCertificate::CommonName).join(' ');
-    qDebug() << "ORG:" << cert.subjectInfo(QSslCertificate::Organization).join(' ');
-    qDebug() << "---issuer";
-    qDebug() << "CN: " << cert.issuerInfo(QSslCertificate::CommonName);
-    qDebug() << "ORG:" << cert.issuerInfo(QSslCertificate::Organization);
-    qDebug() << "";
+    logRecord(QtDebugMsg,
+              "peer_certificate",
+              {{"digest", cert.digest().toHex()},
+               {"serial", cert.serialNumber().toHex()},
+               {"subject_cn", cert.subjectInfo(QSslCertificate::CommonName).join(' ')},
+               {"subject_org", cert.subjectInfo(QSslCertificate::Organization).join(' ')},
+               {"issuer_cn", cert.issuerInfo(QSslCertificate::CommonName).join(' ')},
+               {"issuer_org", cert.issuerInfo(QSslCertificate::Organization).join(' ')}});
 }
 
 
 using SslErrs = QList<QSslError> const&;
 void dumpSslErrors(SslErrs errors, QSslSocket const& forSocket)
 {
-    qDebug() << "SSL errors:";
+    // handshake failure storms repeat the same errors over and over - per peer and errors, only a
+    // burst of 3 records is logged, then one a minute
+    static LogRateLimiter limiter(3, 60 * 1000);
+
+    auto const peer = forSocket.peerAddress().toString();
+    auto key = peer;
     for (auto const& error : errors)
     {
-        qCritical() << error.errorString();
+        key += ' ' + QString::number(error.error());
+    }
+
+    auto suppressed = 0;
+    if (!limiter.allow(key, suppressed))
+    {
+        return;
     }
 
-    qDebug() << "peer certificate chain:";
+    QStringList errorStrings;
+    for (auto const& error : errors)
+    {
+        errorStrings << error.errorString();
+    }
+
+    logRecord(QtCriticalMsg,
+              "ssl_errors",
+              {{"peer", peer},
+               {"errors", errorStrings.join("; ")},
+               {"suppressed", QString::number(suppressed)}});
+
     auto const& peerCertificateChain = forSocket.peerCertificateChain();
     std::for_each(peerCertificateChain.cbegin(), peerCertificateChain.cend(), dumpCert);
 }
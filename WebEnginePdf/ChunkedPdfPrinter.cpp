@@ -0,0 +1,343 @@
+#include "ChunkedPdfPrinter.h"
+
+#include "HtmlChunker.h"
+#include "PdfMerger.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QWebEnginePage>
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <utility>
+
+
+namespace
+{
+enum class Pass { CountPages, Print };
+
+// paged.js calls `after` once the layout is done - page counters are continued by overriding the
+// counter-reset it applies to all pages; paged.js re-parses every other <style> and drops the
+// counter-resets in it, so the override is marked as one of the styles paged.js inserted itself
+QString decorate(QString aChunk, QUrl const& aBaseUrl, int const aFirstPage, int const aTotalPages)
+{
+    QString inject = "<script>window.PagedConfig = {after: function (flow) {"
+                     " window.chunkedPageCount = flow.total; }};</script>\n";
+    if (aTotalPages > 0)
+    {
+        inject += QString("<style data-pagedjs-inserted-styles=\"true\">.pagedjs_pages {"
+                          " counter-reset: page %1 pages %2 !important; }</style>\n")
+                          .arg(aFirstPage)
+                          .arg(aTotalPages);
+    }
+
+    auto const headEnd = aChunk.indexOf("</head>", 0, Qt::CaseInsensitive);
+    (void) aChunk.insert(std::max(0, headEnd), inject);
+
+    // the chunk is loaded from the spool directory - relative URLs still refer to the original
+    static QRegularExpression const headStart("<head\\b[^>]*>",
+                                              QRegularExpression::CaseInsensitiveOption);
+    auto const head = headStart.match(aChunk);
+    return aChunk.insert(head.hasMatch() ? head.capturedEnd() : 0,
+                         QString("\n<base href=\"%1\">").arg(aBaseUrl.toString().toHtmlEscaped()));
+}
+
+} // namespace
+
+
+struct ChunkedPdfPrinter::Data
+{
+    ChunkedPdfPrinter* owner = nullptr;
+
+    int sectionsPerChunk = 8;
+    int maxParallelPages = std::max(2, QThread::idealThreadCount() / 2);
+    int maxChunkSize = 1024 * 1024;
+    int layoutTimeout = 120 * 1000;
+
+    // the current job - its chunks are kept in the spool directory only, w/o the scripts and the
+    // end of the document known only after the whole document was read
+    int chunkCount = 0;
+    QString suffix;
+    QUrl baseUrl;
+    QPageLayout layout;
+    QString fileName;
+    Callback callback;
+
+    Pass pass = Pass::CountPages;
+    QVector<int> pageCounts;
+    int nextChunk = 0;
+    int running = 0;
+    bool failed = false;
+
+    std::unique_ptr<QTemporaryDir> spool;
+
+    QString chunkFileName(int const aChunk, QString const& aSuffix) const
+    {
+        return spool->filePath(QString("chunk_%1%2").arg(aChunk).arg(aSuffix));
+    }
+
+    // every chunk is written as soon as it is cut - the source is never read into memory as whole
+    bool spoolChunks(QString const& aSource)
+    {
+        QFile source(aSource);
+        if (!source.open(QIODevice::ReadOnly))
+        {
+            qCritical() << "unable to read" << aSource;
+            return false;
+        }
+
+        HtmlChunker chunker(sectionsPerChunk, maxChunkSize);
+        auto const spooled = chunker.split(source, [this, i = 0](QString const& chunk) mutable {
+            QFile f(chunkFileName(i++, ".html"));
+            if (!f.open(QIODevice::WriteOnly) || f.write(chunk.toUtf8()) < 0)
+            {
+                qCritical() << "unable to spool chunk to" << f.fileName();
+                return false;
+            }
+            return true;
+        });
+        chunkCount = chunker.chunkCount();
+        suffix = chunker.suffix();
+
+        // w/o paged.js nobody tells when the layout is done, nor how many pages it has
+        if (spooled && !HtmlChunker::usesPagedJs(chunker.head() + suffix))
+        {
+            qWarning() << "not a paged.js document - ignoring" << aSource;
+            return false;
+        }
+        return spooled;
+    }
+
+    void startPass(Pass const aPass)
+    {
+        pass = aPass;
+        nextChunk = 0;
+        fillPages();
+    }
+
+    void fillPages()
+    {
+        while (!failed && running < maxParallelPages && nextChunk < chunkCount)
+        {
+            render(nextChunk++);
+        }
+
+        if (running > 0)
+        {
+            return;
+        }
+
+        if (failed)
+        {
+            finish(false);
+        }
+        else if (pass == Pass::CountPages)
+        {
+            startPass(Pass::Print);
+        }
+        else
+        {
+            finish(merge());
+        }
+    }
+
+    void render(int const aChunk)
+    {
+        ++running;
+
+        auto firstPage = 0;
+        auto totalPages = 0;
+        if (pass == Pass::Print)
+        {
+            firstPage = std::accumulate(pageCounts.cbegin(), pageCounts.cbegin() + aChunk, 0);
+            totalPages = std::accumulate(pageCounts.cbegin(), pageCounts.cend(), 0);
+        }
+
+        auto* const page = new QWebEnginePage(owner);
+        auto* const poll = new QTimer(page);
+        poll->setInterval(50);
+
+        // paged.js may fail or take forever - the chunk fails then, instead of blocking the job
+        auto* const timeout = new QTimer(page);
+        timeout->setSingleShot(true);
+        timeout->setInterval(layoutTimeout);
+
+        // done with the chunk - the page is released, so only a few renderers are alive at a time
+        auto const finished = std::make_shared<bool>(false);
+        auto const done = [=](bool const ok) {
+            if (std::exchange(*finished, true))
+            {
+                return;
+            }
+
+            poll->stop();
+            timeout->stop();
+            failed = failed || !ok;
+            --running;
+            page->deleteLater();
+            fillPages();
+        };
+
+        QObject::connect(timeout, &QTimer::timeout, page, [=]() {
+            qCritical() << "chunk" << aChunk << "not laid out within" << layoutTimeout << "ms";
+            done(false);
+        });
+
+        QObject::connect(page, &QWebEnginePage::loadFinished, page, [=](bool const ok) {
+            if (!ok)
+            {
+                qCritical() << "unable to load chunk" << aChunk;
+                done(false);
+                return;
+            }
+            poll->start();
+        });
+
+        // paged.js lays out asynchronously after the page was loaded
+        QObject::connect(poll, &QTimer::timeout, page, [=]() {
+            page->runJavaScript("window.chunkedPageCount || 0", [=](QVariant const& count) {
+                if (count.toInt() == 0 || !poll->isActive())
+                {
+                    return;
+                }
+                poll->stop();
+
+                if (pass == Pass::CountPages)
+                {
+                    pageCounts[aChunk] = count.toInt();
+                    done(true);
+                }
+                else
+                {
+                    page->printToPdf(chunkFileName(aChunk, ".pdf"), layout);
+                }
+            });
+        });
+
+        QObject::connect(page,
+                         &QWebEnginePage::pdfPrintingFinished,
+                         page,
+                         [=](QString const&, bool const ok) { done(ok); });
+
+        // only the one chunk is read into memory - decorated for this pass
+        QFile chunk(chunkFileName(aChunk, ".html"));
+        QFile decorated(chunkFileName(aChunk, "_decorated.html"));
+        if (!chunk.open(QIODevice::ReadOnly) || !decorated.open(QIODevice::WriteOnly)
+            || decorated.write(decorate(QString::fromUtf8(chunk.readAll()) + suffix,
+                                        baseUrl,
+                                        firstPage,
+                                        totalPages)
+                                       .toUtf8())
+                       < 0)
+        {
+            qCritical() << "unable to prepare chunk" << aChunk;
+            QTimer::singleShot(0, page, [=]() { done(false); });
+            return;
+        }
+        decorated.close();
+
+        timeout->start();
+        page->load(QUrl::fromLocalFile(decorated.fileName()));
+    }
+
+    bool merge() const
+    {
+        QFile out(fileName);
+        if (!out.open(QIODevice::WriteOnly))
+        {
+            qCritical() << "unable to write" << fileName;
+            return false;
+        }
+
+        // only one chunk at a time is read into memory
+        PdfMerger merger(out);
+        for (auto i = 0; i < chunkCount; ++i)
+        {
+            QFile chunk(chunkFileName(i, ".pdf"));
+            if (!chunk.open(QIODevice::ReadOnly) || !merger.append(chunk.readAll()))
+            {
+                qCritical() << "unable to merge chunk" << i;
+                return false;
+            }
+        }
+
+        return merger.finish();
+    }
+
+    void finish(bool const aSuccess)
+    {
+        spool.reset();
+        chunkCount = 0;
+        suffix.clear();
+
+        auto const cb = std::move(callback);
+        callback = nullptr;
+        cb(aSuccess);
+    }
+};
+
+
+ChunkedPdfPrinter::ChunkedPdfPrinter(QObject* aParent)
+    : QObject(aParent)
+    , d(std::make_unique<Data>())
+{
+    d->owner = this;
+}
+ChunkedPdfPrinter::~ChunkedPdfPrinter() = default;
+
+
+void ChunkedPdfPrinter::setSectionsPerChunk(int const aSections)
+{
+    d->sectionsPerChunk = std::max(1, aSections);
+}
+
+
+void ChunkedPdfPrinter::setMaxParallelPages(int const aPages)
+{
+    d->maxParallelPages = std::max(1, aPages);
+}
+
+
+void ChunkedPdfPrinter::setMaxChunkSize(int const aCharacters)
+{
+    d->maxChunkSize = std::max(1, aCharacters);
+}
+
+
+void ChunkedPdfPrinter::setLayoutTimeout(int const aMilliseconds)
+{
+    d->layoutTimeout = std::max(1, aMilliseconds);
+}
+
+
+void ChunkedPdfPrinter::print(QString const& aSource,
+                              QUrl const& aBaseUrl,
+                              QPageLayout const& aLayout,
+                              QString const& aFileName,
+                              Callback aCallback)
+{
+    if (d->callback)
+    {
+        qWarning() << "already printing - ignoring" << aFileName;
+        aCallback(false);
+        return;
+    }
+
+    d->spool = std::make_unique<QTemporaryDir>();
+    d->baseUrl = aBaseUrl;
+    d->layout = aLayout;
+    d->fileName = aFileName;
+    d->callback = std::move(aCallback);
+    d->failed = !d->spool->isValid() || !d->spoolChunks(aSource);
+    d->pageCounts = QVector<int>(d->chunkCount, 0);
+
+    qDebug() << "printing" << d->chunkCount << "chunks to" << aFileName;
+    d->startPass(Pass::CountPages);
+}
+
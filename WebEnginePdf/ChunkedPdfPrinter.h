@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QObject>
+#include <QPageLayout>
+#include <QString>
+#include <QUrl>
+
+#include <functional>
+#include <memory>
+
+
+/**
+ * Prints very large paged.js documents in chunks, so neither a single renderer has to lay out the
+ * whole document nor has the whole document or PDF to be kept in memory.
+ *
+ * The document @a aSource is read and split by the HtmlChunker into chunks of sections starting
+ * at elements with the class `pagebreak`, as their layout doesn't depend on each other - a section
+ * larger than `maxChunkSize` characters is cut further, e.g. between table rows. Every chunk is
+ * written to a temporary directory as soon as it is cut, so the memory needed grows with the
+ * chunk size, not the document size - except for the `<head>` and the `<script>`s, which are part
+ * of every chunk.
+ *
+ * Chunks are loaded from the temporary directory - so `setHtml()`'s 2 MB limit doesn't apply - on
+ * separate pages, at most `maxParallelPages` at a time:
+ * 1. the first pass lays out every chunk only to count its pages
+ * 2. the second pass lays out every chunk again, with `@page` counters continued from the previous
+ *    chunks and the total page count, and prints it to a temporary PDF
+ *
+ * The temporary PDFs are finally merged one by one into @a aFileName.
+ *
+ * Only documents using the paged.js polyfill can be printed, as it tells the page count of a chunk.
+ * A chunk not laid out within `layoutTimeout` fails the whole job.
+ */
+class ChunkedPdfPrinter final : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void(bool aSuccess)>;
+
+    explicit ChunkedPdfPrinter(QObject* aParent = nullptr);
+    ~ChunkedPdfPrinter() override;
+
+    void setSectionsPerChunk(int aSections);
+    void setMaxParallelPages(int aPages);
+    void setMaxChunkSize(int aCharacters);
+    void setLayoutTimeout(int aMilliseconds);
+
+    void print(QString const& aSource,
+               QUrl const& aBaseUrl,
+               QPageLayout const& aLayout,
+               QString const& aFileName,
+               Callback aCallback);
+
+private:
+    struct Data;
+    std::unique_ptr<Data> d;
+};
@@ -0,0 +1,61 @@
+#include "ChunkedPdfPrinterTest.h"
+
+#include "ChunkedPdfPrinter.h"
+
+#include <QFile>
+#include <QPdfDocument>
+#include <QPdfSelection>
+#include <QTemporaryDir>
+
+
+void ChunkedPdfPrinterTest::testThatPageNumbersContinueAcrossChunks()
+{
+    // ARRANGE - 3 sections of a page each, every one printed in a chunk of its own
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QFile source(dir.filePath("report.html"));
+    QVERIFY(source.open(QIODevice::WriteOnly));
+    (void) source.write(
+            "<html><head><style>\n"
+            "@page { @bottom-center { content: 'Page ' counter(page) ' of ' counter(pages); } }\n"
+            ".pagebreak { break-before: page; }\n"
+            "</style></head><body>\n"
+            "<h1>Section 1</h1>\n"
+            "<h1 class=\"pagebreak\">Section 2</h1>\n"
+            "<h1 class=\"pagebreak\">Section 3</h1>\n"
+            "<script src=\"paged.polyfill.js\"></script>\n"
+            "</body></html>\n");
+    source.close();
+
+    ChunkedPdfPrinter printer;
+    printer.setSectionsPerChunk(1);
+
+    // ACT - the polyfill is loaded from the sources, relative to the base URL
+    auto done = false;
+    auto success = false;
+    printer.print(source.fileName(),
+                  QUrl::fromLocalFile(PAGED_JS_DIR),
+                  {QPageSize(QPageSize::A5), QPageLayout::Portrait, QMarginsF()},
+                  dir.filePath("report.pdf"),
+                  [&](bool const ok) {
+                      success = ok;
+                      done = true;
+                  });
+    QTRY_VERIFY_WITH_TIMEOUT(done, 240 * 1000);
+    QVERIFY(success);
+
+    // ASSERT - every page tells its number within the merged PDF, not within its chunk
+    QPdfDocument pdf;
+    QCOMPARE(pdf.load(dir.filePath("report.pdf")), QPdfDocument::NoError);
+    QCOMPARE(pdf.pageCount(), 3);
+    for (auto i = 0; i < pdf.pageCount(); ++i)
+    {
+        auto const text = pdf.getAllText(i).text().simplified();
+        QVERIFY2(text.contains(QString("Section %1").arg(i + 1)), qPrintable(text));
+        QVERIFY2(text.contains(QString("Page %1 of 3").arg(i + 1)), qPrintable(text));
+    }
+}
+
+
+QTEST_MAIN(ChunkedPdfPrinterTest)
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QTest>
+
+
+class ChunkedPdfPrinterTest final : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    static void testThatPageNumbersContinueAcrossChunks();
+};
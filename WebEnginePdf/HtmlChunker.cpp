@@ -0,0 +1,337 @@
+#include "HtmlChunker.h"
+
+#include <QIODevice>
+#include <QRegularExpression>
+#include <QSet>
+#include <QTextStream>
+#include <QVector>
+
+#include <algorithm>
+
+
+namespace
+{
+constexpr qint64 BlockSize = 64 * 1024;
+
+QRegularExpression const& pagebreak()
+{
+    static QRegularExpression const re(
+            "<[a-zA-Z][^>]*\\bclass\\s*=\\s*[\"'][^\"']*\\bpagebreak\\b[^>]*>");
+    return re;
+}
+
+
+QString withoutPagebreak(QString aTag)
+{
+    return aTag.remove(QRegularExpression("\\bpagebreak\\b"));
+}
+
+} // namespace
+
+
+struct HtmlChunker::Data
+{
+    int sectionsPerChunk = 0;
+    int maxChunkSize = 0;
+    Writer writer;
+
+    QString head;
+    QString scripts;
+    QString tail;
+
+    // the piece of the current section being cut - with the elements open in it
+    struct Open
+    {
+        QString name;
+        QString tag;
+        int start;
+        QString header;
+    };
+    QVector<Open> open;
+    QString piece;
+    int reopenedSize = 0;
+    qint64 bodySize = 0;
+
+    // the pieces grouped into the current chunk
+    QString chunk;
+    int piecesInChunk = 0;
+    int chunkCount = 0;
+    bool failed = false;
+
+    int maxSize() const
+    {
+        return std::max(1, maxChunkSize - head.size());
+    }
+
+    void text(QString const& aText)
+    {
+        piece += aText;
+        bodySize += aText.size();
+    }
+
+    void startTag(QString const& aName, QString const& aTag, bool const aSelfClosing)
+    {
+        static QSet<QString> const voidElements {"area", "base", "br", "col", "embed",
+                                                 "hr", "img", "input", "link", "meta",
+                                                 "source", "track", "wbr"};
+        static QSet<QString> const blocks {"article", "blockquote", "dd", "div", "dl", "dt",
+                                           "figure", "h1", "h2", "h3", "h4", "h5", "h6",
+                                           "li", "ol", "p", "pre", "section", "table",
+                                           "tbody", "tr", "ul"};
+
+        // a section starts at each element forcing a page break
+        if (bodySize > 0 && pagebreak().match(aTag).hasMatch())
+        {
+            endSection();
+        }
+
+        // a section too large for one chunk is cut before block elements - never within a header
+        auto const inHeader = std::any_of(
+                open.cbegin(), open.cend(), [](Open const& o) { return o.name == "thead"; });
+        if (blocks.contains(aName) && !inHeader && piece.size() >= maxSize()
+            && piece.size() > reopenedSize)
+        {
+            cut();
+        }
+
+        if (!aSelfClosing && !voidElements.contains(aName))
+        {
+            open.append({aName, withoutPagebreak(aTag), piece.size(), {}});
+        }
+        text(aTag);
+    }
+
+    void endTag(QString const& aName, QString const& aTag)
+    {
+        text(aTag);
+
+        for (auto i = open.size() - 1; i >= 0; --i)
+        {
+            if (open[i].name != aName)
+            {
+                continue;
+            }
+
+            // a table's header is repeated in every piece of the table
+            if (aName == "thead" && i > 0 && open[i - 1].name == "table")
+            {
+                open[i - 1].header = piece.mid(open[i].start);
+            }
+            open.resize(i);
+            break;
+        }
+    }
+
+    // the elements open at the cut are closed here and opened again in the next piece
+    void cut()
+    {
+        QString closing;
+        for (auto i = open.size() - 1; i >= 0; --i)
+        {
+            closing += "</" + open[i].name + ">";
+        }
+        addPiece(piece + closing);
+
+        piece.clear();
+        for (auto const& o : qAsConst(open))
+        {
+            piece += o.tag + o.header;
+        }
+        reopenedSize = piece.size();
+    }
+
+    void endSection()
+    {
+        addPiece(piece);
+        piece.clear();
+        open.clear();
+        reopenedSize = 0;
+    }
+
+    void addPiece(QString const& aPiece)
+    {
+        if (piecesInChunk > 0
+            && (piecesInChunk == sectionsPerChunk
+                || chunk.size() + aPiece.size() > maxSize()))
+        {
+            writeChunk();
+        }
+
+        chunk += aPiece;
+        ++piecesInChunk;
+    }
+
+    void writeChunk()
+    {
+        // a chunk starts on a new page anyway - the explicit break would add an empty one
+        auto const match = pagebreak().match(chunk);
+        if (chunkCount > 0 && match.capturedStart() == 0)
+        {
+            chunk.replace(0, match.capturedLength(), withoutPagebreak(match.captured(0)));
+        }
+
+        failed = failed || !writer(head + chunk);
+        ++chunkCount;
+        chunk.clear();
+        piecesInChunk = 0;
+    }
+};
+
+
+HtmlChunker::HtmlChunker(int const aSectionsPerChunk, int const aMaxChunkSize)
+    : d(std::make_unique<Data>())
+{
+    d->sectionsPerChunk = std::max(1, aSectionsPerChunk);
+    d->maxChunkSize = std::max(1, aMaxChunkSize);
+}
+HtmlChunker::~HtmlChunker() = default;
+
+
+bool HtmlChunker::split(QIODevice& aSource, Writer const& aWriter)
+{
+    static QRegularExpression const bodyStart("<body[^>]*>",
+                                              QRegularExpression::CaseInsensitiveOption);
+    static QRegularExpression const tag("<(/?)([a-zA-Z][a-zA-Z0-9]*)\\b[^>]*?(/?)>");
+
+    auto fresh = std::make_unique<Data>();
+    fresh->sectionsPerChunk = d->sectionsPerChunk;
+    fresh->maxChunkSize = d->maxChunkSize;
+    fresh->writer = aWriter;
+    d = std::move(fresh);
+
+    QTextStream in(&aSource);
+    in.setCodec("UTF-8");
+
+    // the source is read block by block - what's left of the previous block is kept if needed
+    QString buffer;
+    auto pos = 0;
+    auto const readMore = [&]() {
+        if (in.atEnd())
+        {
+            return false;
+        }
+        buffer = buffer.mid(pos) + in.read(BlockSize);
+        pos = 0;
+        return true;
+    };
+
+    auto start = bodyStart.match(buffer);
+    while (!start.hasMatch())
+    {
+        // w/o a body the document is a single chunk
+        if (!readMore())
+        {
+            d->head = buffer;
+            d->chunkCount = 1;
+            return aWriter(buffer);
+        }
+        start = bodyStart.match(buffer);
+    }
+    d->head = buffer.left(start.capturedEnd());
+    pos = start.capturedEnd();
+
+    while (!d->failed)
+    {
+        auto const lt = buffer.indexOf('<', pos);
+        if (lt < 0)
+        {
+            d->text(buffer.mid(pos));
+            pos = buffer.size();
+            if (!readMore())
+            {
+                break;
+            }
+            continue;
+        }
+        d->text(buffer.mid(pos, lt - pos));
+        pos = lt;
+
+        // a tag is only matched once it was read completely
+        if (buffer.indexOf('>', pos) < 0)
+        {
+            if (!readMore())
+            {
+                d->text(buffer.mid(pos));
+                break;
+            }
+            continue;
+        }
+
+        auto const match = tag.match(buffer,
+                                     pos,
+                                     QRegularExpression::NormalMatch,
+                                     QRegularExpression::AnchoredMatchOption);
+        if (!match.hasMatch())
+        {
+            d->text("<");
+            ++pos;
+            continue;
+        }
+
+        auto const name = match.captured(2).toLower();
+        if (match.captured(1) == "/")
+        {
+            if (name == "body")
+            {
+                d->tail = buffer.mid(pos) + in.readAll();
+                break;
+            }
+
+            d->endTag(name, match.captured(0));
+            pos = match.capturedEnd();
+            continue;
+        }
+
+        // scripts - like the paged.js polyfill - are needed by every chunk
+        if (name == "script")
+        {
+            auto const end = buffer.indexOf("</script>", pos, Qt::CaseInsensitive);
+            if (end < 0 && readMore())
+            {
+                continue;
+            }
+
+            auto const length = end < 0 ? buffer.size() - pos : end + 9 - pos;
+            d->scripts += buffer.mid(pos, length) + "\n";
+            pos += length;
+            continue;
+        }
+
+        d->startTag(name, match.captured(0), match.captured(3) == "/");
+        pos = match.capturedEnd();
+    }
+
+    if (!d->failed)
+    {
+        d->endSection();
+        d->writeChunk();
+    }
+    return !d->failed;
+}
+
+
+int HtmlChunker::chunkCount() const
+{
+    return d->chunkCount;
+}
+
+
+QString const& HtmlChunker::head() const
+{
+    return d->head;
+}
+
+
+QString HtmlChunker::suffix() const
+{
+    return d->scripts + d->tail;
+}
+
+
+bool HtmlChunker::usesPagedJs(QString const& aHtml)
+{
+    static QRegularExpression const polyfill(
+            "<script\\b[^>]*\\bsrc\\s*=\\s*[\"'][^\"']*paged[^\"']*\\.js[\"']",
+            QRegularExpression::CaseInsensitiveOption);
+    return polyfill.match(aHtml).hasMatch();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QString>
+
+#include <functional>
+#include <memory>
+
+class QIODevice;
+
+
+/**
+ * Splits a HTML document into chunks while reading it, handing every chunk to @a aWriter as soon
+ * as it's cut - so only the chunk being cut is kept in memory, not the document.
+ *
+ * The `<body>` is split into sections starting at elements with the class `pagebreak`, and
+ * consecutive sections are grouped into chunks of at most `aSectionsPerChunk` sections and
+ * `aMaxChunkSize` characters. A section larger than that is cut further before block elements,
+ * e.g. table rows - closing the elements open at the cut and opening them again, with the table
+ * header repeated, in the next chunk.
+ *
+ * Every chunk starts with the `<head>` of the document. The `<script>`s of the `<body>` and
+ * everything from `</body>` on are only known once the whole document was read - they are to be
+ * appended to every chunk as its `suffix()`.
+ *
+ * The HTML is expected to close all of its non-void elements.
+ */
+class HtmlChunker final
+{
+public:
+    using Writer = std::function<bool(QString const& aChunk)>;
+
+    HtmlChunker(int aSectionsPerChunk, int aMaxChunkSize);
+    ~HtmlChunker();
+
+    bool split(QIODevice& aSource, Writer const& aWriter);
+
+    int chunkCount() const;
+    QString const& head() const;
+    QString suffix() const;
+
+    static bool usesPagedJs(QString const& aHtml);
+
+private:
+    struct Data;
+    std::unique_ptr<Data> d;
+};
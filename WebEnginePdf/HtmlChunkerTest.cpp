@@ -0,0 +1,158 @@
+#include "HtmlChunkerTest.h"
+
+#include "HtmlChunker.h"
+
+#include <QBuffer>
+
+#include <algorithm>
+
+
+namespace
+{
+QString document(QString const& aBody)
+{
+    return "<html><head><title>t</title></head><body>" + aBody
+           + "<script src=\"paged.polyfill.js\"></script></body></html>";
+}
+
+// the chunks as complete documents - w/ the suffix appended
+QStringList split(QString const& aHtml, int const aSectionsPerChunk, int const aMaxChunkSize)
+{
+    auto source = aHtml.toUtf8();
+    QBuffer buffer(&source);
+    (void) buffer.open(QIODevice::ReadOnly);
+
+    QStringList chunks;
+    HtmlChunker chunker(aSectionsPerChunk, aMaxChunkSize);
+    if (!chunker.split(buffer, [&chunks](QString const& chunk) {
+            chunks << chunk;
+            return true;
+        }))
+    {
+        return {};
+    }
+
+    for (auto& chunk : chunks)
+    {
+        chunk += chunker.suffix();
+    }
+    return chunks;
+}
+
+QString bodyOf(QString const& aChunk)
+{
+    auto const start = aChunk.indexOf("<body>") + 6;
+    return aChunk.mid(start, aChunk.indexOf("<script") - start);
+}
+
+QString rows(int const aCount)
+{
+    QString rows;
+    for (auto i = 0; i < aCount; ++i)
+    {
+        rows += QString("<tr><td>row %1</td></tr>").arg(i, 5, 10, QChar('0'));
+    }
+    return rows;
+}
+
+} // namespace
+
+
+void HtmlChunkerTest::testThatOnlyPagedJsDocumentsAreAccepted()
+{
+    QVERIFY(HtmlChunker::usesPagedJs(document("")));
+    QVERIFY(!HtmlChunker::usesPagedJs("<html><body><p>plain</p></body></html>"));
+    QVERIFY(!HtmlChunker::usesPagedJs("<html><body><script>paged()</script></body></html>"));
+}
+
+
+void HtmlChunkerTest::testThatSplittingGroupsSectionsAtPagebreaks()
+{
+    auto const html = document("<h1>a</h1><h1 class=\"pagebreak\">b</h1>"
+                               "<h1 class=\"pagebreak\">c</h1>");
+
+    auto const chunks = split(html, 2, 1024 * 1024);
+    QCOMPARE(chunks.size(), 2);
+
+    // every chunk is a complete document w/ the scripts moved to its end
+    for (auto const& chunk : chunks)
+    {
+        QVERIFY(chunk.startsWith("<html><head><title>t</title></head><body>"));
+        QVERIFY(chunk.endsWith("<script src=\"paged.polyfill.js\"></script>\n</body></html>"));
+    }
+
+    QCOMPARE(bodyOf(chunks[0]), QString("<h1>a</h1><h1 class=\"pagebreak\">b</h1>"));
+
+    // the chunk starts on a new page anyway
+    QCOMPARE(bodyOf(chunks[1]), QString("<h1 class=\"\">c</h1>"));
+}
+
+
+void HtmlChunkerTest::testThatSplittingCutsLargeTablesBetweenRows()
+{
+    auto const html = document("<table class=\"data\"><thead><tr><th>h</th></tr></thead>"
+                               "<tbody>"
+                               + rows(100) + "</tbody></table>");
+
+    auto const chunks = split(html, 8, 1000);
+    QVERIFY(chunks.size() > 1);
+
+    QString allRows;
+    for (auto const& chunk : chunks)
+    {
+        QVERIFY(chunk.size() <= 1100);
+
+        // every piece is a complete table, w/ the header repeated
+        auto const body = bodyOf(chunk);
+        QVERIFY(body.startsWith(
+                "<table class=\"data\"><thead><tr><th>h</th></tr></thead><tbody>"));
+        QVERIFY(body.endsWith("</tbody></table>"));
+
+        allRows += body.mid(body.indexOf("<tbody>") + 7).chopped(16);
+    }
+
+    // no row is lost, cut or duplicated
+    QCOMPARE(allRows, rows(100));
+}
+
+
+void HtmlChunkerTest::testThatSplittingWritesChunksWhileReading()
+{
+    // ARRANGE - a document spanning several of the blocks read, w/ a script in between the rows
+    auto const html = "<html><head><title>t</title></head><body><table><tbody>" + rows(5000)
+                      + "<script>var x = '" + QString(100 * 1024, 'x') + "';</script>" + rows(10)
+                      + "</tbody></table><script src=\"paged.polyfill.js\"></script></body></html>";
+    auto source = html.toUtf8();
+    QBuffer buffer(&source);
+    (void) buffer.open(QIODevice::ReadOnly);
+
+    // ACT - the source read so far is recorded w/ every chunk written
+    QVector<qint64> readAt;
+    auto maxSize = 0;
+    QString allRows;
+    HtmlChunker chunker(8, 16 * 1024);
+    auto const ok = chunker.split(buffer, [&](QString const& chunk) {
+        readAt << buffer.pos();
+        maxSize = std::max(maxSize, int(chunk.size()));
+
+        auto const body = chunk.mid(chunk.indexOf("<tbody>") + 7);
+        allRows += body.left(body.indexOf("</tbody>"));
+        return true;
+    });
+
+    // ASSERT - the first chunks are written long before the whole source was read
+    QVERIFY(ok);
+    QCOMPARE(chunker.chunkCount(), readAt.size());
+    QVERIFY(maxSize <= 16 * 1024 + 64);
+    QVERIFY(readAt.size() > 4);
+    QVERIFY(readAt.first() < source.size() / 2);
+
+    // ASSERT - no row is lost, the scripts are moved to the end
+    QCOMPARE(allRows, rows(5000) + rows(10));
+    QVERIFY(chunker.suffix().startsWith("<script>var x = 'xxx"));
+    QVERIFY(chunker.suffix().endsWith("</script>\n</body></html>"));
+    QVERIFY(HtmlChunker::usesPagedJs(chunker.head() + chunker.suffix()));
+}
+
+
+QTEST_MAIN(HtmlChunkerTest)
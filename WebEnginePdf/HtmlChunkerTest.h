@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QTest>
+
+
+class HtmlChunkerTest final : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    static void testThatOnlyPagedJsDocumentsAreAccepted();
+    static void testThatSplittingGroupsSectionsAtPagebreaks();
+    static void testThatSplittingCutsLargeTablesBetweenRows();
+    static void testThatSplittingWritesChunksWhileReading();
+};
@@ -0,0 +1,333 @@
+#include "PdfMerger.h"
+
+#include <QDebug>
+#include <QIODevice>
+#include <QMap>
+#include <QRegularExpression>
+#include <QVector>
+
+#include <algorithm>
+
+
+namespace
+{
+struct Input
+{
+    QByteArray const& pdf;
+
+    // offset of every object in use, ordered by object number - and ordered by offset
+    QMap<int, qint64> objects;
+    QVector<qint64> offsets;
+    qint64 xref = -1;
+
+    int size = 0;
+    int root = 0;
+    int info = 0;
+};
+
+
+int capturedNumber(QRegularExpression const& aRe, QByteArray const& aText)
+{
+    auto const match = aRe.match(QString::fromLatin1(aText));
+    return match.hasMatch() ? match.captured(1).toInt() : 0;
+}
+
+
+// parses the trailer and the classic cross-reference table it points to
+bool parseXref(Input& in)
+{
+    auto const startxref = in.pdf.lastIndexOf("startxref");
+    auto const trailer = in.pdf.lastIndexOf("trailer", startxref);
+    if (startxref < 0 || trailer < 0)
+    {
+        qCritical() << "PDF without trailer - cross-reference streams are not supported";
+        return false;
+    }
+
+    auto const trailerDict = in.pdf.mid(trailer, startxref - trailer);
+    if (trailerDict.contains("/Prev"))
+    {
+        qCritical() << "PDF with incremental updates is not supported";
+        return false;
+    }
+
+    in.size = capturedNumber(QRegularExpression("/Size\\s+(\\d+)"), trailerDict);
+    in.root = capturedNumber(QRegularExpression("/Root\\s+(\\d+)\\s+\\d+\\s+R"), trailerDict);
+    in.info = capturedNumber(QRegularExpression("/Info\\s+(\\d+)\\s+\\d+\\s+R"), trailerDict);
+
+    in.xref = in.pdf.mid(startxref + 9, 32).simplified().split(' ').value(0).toLongLong();
+    auto const tokens = in.pdf.mid(in.xref, trailer - in.xref).simplified().split(' ');
+    if (tokens.value(0) != "xref")
+    {
+        qCritical() << "PDF without cross-reference table at" << in.xref;
+        return false;
+    }
+
+    // subsections of "<first> <count>" followed by <count> entries of "<offset> <gen> <n|f>"
+    for (auto i = 1; i + 1 < tokens.size();)
+    {
+        auto const first = tokens[i].toInt();
+        auto const count = tokens[i + 1].toInt();
+        i += 2;
+
+        for (auto n = first; n < first + count && i + 2 < tokens.size(); ++n, i += 3)
+        {
+            if (tokens[i + 2] == "n")
+            {
+                in.objects.insert(n, tokens[i].toLongLong());
+            }
+        }
+    }
+
+    in.offsets = in.objects.values().toVector();
+    std::sort(in.offsets.begin(), in.offsets.end());
+
+    return in.size > 0 && in.root > 0 && !in.objects.isEmpty();
+}
+
+
+// the complete "<n> <gen> obj ... endobj" of an object
+QByteArray objectAt(Input const& in, qint64 const aOffset)
+{
+    // objects don't overlap, so an object ends before the next one - or the xref table - starts
+    auto const next = std::upper_bound(in.offsets.cbegin(), in.offsets.cend(), aOffset);
+    auto const end = next != in.offsets.cend() ? *next : in.xref;
+
+    auto const object = in.pdf.mid(aOffset, end - aOffset);
+    return object.left(object.lastIndexOf("endobj") + 6);
+}
+
+
+// shifts all indirect references "<n> <gen> R" by aBase - leaving strings untouched
+QByteArray renumber(QByteArray const& aText, int const aBase)
+{
+    static QRegularExpression const reference("\\b(\\d+)(\\s+)(\\d+)(\\s+)R\\b");
+
+    auto const renumberSegment = [&](QByteArray const& aSegment) {
+        auto const segment = QString::fromLatin1(aSegment);
+        QString result;
+
+        auto last = 0;
+        auto it = reference.globalMatch(segment);
+        while (it.hasNext())
+        {
+            auto const match = it.next();
+            result += segment.midRef(last, match.capturedStart() - last);
+            result += QString::number(match.captured(1).toInt() + aBase) + match.captured(2)
+                      + match.captured(3) + match.captured(4) + 'R';
+            last = match.capturedEnd();
+        }
+        result += segment.midRef(last);
+
+        return result.toLatin1();
+    };
+
+    QByteArray result;
+    auto segmentStart = 0;
+    for (auto i = 0; i < aText.size();)
+    {
+        auto const c = aText[i];
+        auto end = i;
+
+        if (c == '(')
+        {
+            // literal strings may contain balanced parentheses and escapes
+            for (auto depth = 0; end < aText.size(); ++end)
+            {
+                if (aText[end] == '\\')
+                {
+                    ++end;
+                }
+                else if (aText[end] == '(')
+                {
+                    ++depth;
+                }
+                else if (aText[end] == ')' && --depth == 0)
+                {
+                    break;
+                }
+            }
+        }
+        else if (c == '<' && aText.mid(i, 2) != "<<")
+        {
+            end = aText.indexOf('>', i);
+        }
+        else
+        {
+            i += c == '<' ? 2 : 1;
+            continue;
+        }
+
+        end = end < 0 ? aText.size() : std::min(end + 1, aText.size());
+        result += renumberSegment(aText.mid(segmentStart, i - segmentStart));
+        result += aText.mid(i, end - i);
+        segmentStart = i = end;
+    }
+    result += renumberSegment(aText.mid(segmentStart));
+
+    return result;
+}
+
+// the common page tree root and catalog get the first object numbers
+constexpr int PagesObject = 1;
+constexpr int CatalogObject = 2;
+
+} // namespace
+
+
+struct PdfMerger::Data
+{
+    QIODevice& output;
+    qint64 written = 0;
+
+    int nextObject = CatalogObject + 1;
+    QVector<qint64> offsets;
+
+    QList<int> kids;
+    int pageCount = 0;
+    int info = 0;
+
+    void write(QByteArray const& aData)
+    {
+        written += output.write(aData);
+    }
+
+    void writeObject(int const aNumber, QByteArray const& aObject)
+    {
+        offsets.resize(std::max(offsets.size(), aNumber + 1));
+        offsets[aNumber] = written;
+        write(aObject);
+        write("\n");
+    }
+};
+
+
+PdfMerger::PdfMerger(QIODevice& aOutput) : d(std::make_unique<Data>(Data {aOutput}))
+{
+}
+PdfMerger::~PdfMerger() = default;
+
+
+bool PdfMerger::append(QByteArray const& aPdf)
+{
+    Input in {aPdf};
+    if (!parseXref(in))
+    {
+        return false;
+    }
+
+    auto const catalog = objectAt(in, in.objects.value(in.root));
+    auto const pagesRoot =
+            capturedNumber(QRegularExpression("/Pages\\s+(\\d+)\\s+\\d+\\s+R"), catalog);
+    if (!in.objects.contains(pagesRoot))
+    {
+        qCritical() << "PDF without page tree";
+        return false;
+    }
+
+    if (d->written == 0)
+    {
+        // keep the version of the first PDF, and mark the file as binary
+        d->write(aPdf.left(aPdf.indexOf('\n') + 1) + "%\xE2\xE3\xCF\xD3\n");
+    }
+
+    auto const base = d->nextObject - 1;
+    if (d->info == 0 && in.info > 0)
+    {
+        d->info = in.info + base;
+    }
+
+    static QRegularExpression const header("^\\s*(\\d+)\\s+(\\d+)\\s+obj");
+    for (auto it = in.objects.cbegin(); it != in.objects.cend(); ++it)
+    {
+        // each input's catalog is replaced by the common one
+        if (it.key() == in.root)
+        {
+            continue;
+        }
+
+        auto const object = objectAt(in, it.value());
+        auto const match = header.match(QString::fromLatin1(object.left(64)));
+        if (!match.hasMatch())
+        {
+            qCritical() << "PDF object" << it.key() << "not found at" << it.value();
+            return false;
+        }
+
+        // stream data is binary and copied as is
+        auto const body = object.mid(match.capturedEnd());
+        auto const stream = body.indexOf("stream");
+        auto dict = renumber(body.left(stream < 0 ? body.size() : stream), base);
+
+        if (it.key() == pagesRoot)
+        {
+            d->pageCount += capturedNumber(QRegularExpression("/Count\\s+(\\d+)"), dict);
+            dict.insert(dict.indexOf("<<") + 2,
+                        " /Parent " + QByteArray::number(PagesObject) + " 0 R");
+            d->kids.append(pagesRoot + base);
+        }
+
+        auto const number = it.key() + base;
+        d->writeObject(number,
+                       QByteArray::number(number) + ' ' + match.captured(2).toLatin1() + " obj"
+                               + dict + (stream < 0 ? QByteArray() : body.mid(stream)));
+    }
+
+    d->nextObject += in.size - 1;
+    return true;
+}
+
+
+bool PdfMerger::finish()
+{
+    if (d->kids.isEmpty())
+    {
+        qCritical() << "no PDF to merge";
+        return false;
+    }
+
+    QByteArray kids;
+    for (auto const kid : qAsConst(d->kids))
+    {
+        kids += QByteArray::number(kid) + " 0 R ";
+    }
+
+    d->writeObject(PagesObject,
+                   QString("%1 0 obj\n<< /Type /Pages /Kids [ %2] /Count %3 >>\nendobj")
+                           .arg(PagesObject)
+                           .arg(QString::fromLatin1(kids))
+                           .arg(d->pageCount)
+                           .toLatin1());
+    d->writeObject(CatalogObject,
+                   QString("%1 0 obj\n<< /Type /Catalog /Pages %2 0 R >>\nendobj")
+                           .arg(CatalogObject)
+                           .arg(PagesObject)
+                           .toLatin1());
+
+    // classic cross-reference table - every entry is exactly 20 bytes long
+    auto const xref = d->written;
+    d->offsets.resize(d->nextObject);
+    d->write("xref\n0 " + QByteArray::number(d->offsets.size()) + "\n");
+    d->write("0000000000 65535 f\r\n");
+    for (auto i = 1; i < d->offsets.size(); ++i)
+    {
+        auto const offset = d->offsets[i];
+        d->write(offset > 0 ? QByteArray::number(offset).rightJustified(10, '0') + " 00000 n\r\n"
+                            : QByteArray("0000000000 00000 f\r\n"));
+    }
+
+    d->write(QString("trailer\n<< /Size %1 /Root %2 0 R ")
+                     .arg(d->offsets.size())
+                     .arg(CatalogObject)
+                     .toLatin1());
+    d->write(d->info > 0 ? "/Info " + QByteArray::number(d->info) + " 0 R >>\n" : ">>\n");
+    d->write("startxref\n" + QByteArray::number(xref) + "\n%%EOF\n");
+
+    return true;
+}
+
+
+int PdfMerger::pageCount() const
+{
+    return d->pageCount;
+}
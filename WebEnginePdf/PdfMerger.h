@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QByteArray>
+
+#include <memory>
+
+class QIODevice;
+
+
+/**
+ * Concatenates the pages of several PDFs into one, writing to @a aOutput while appending - so only
+ * one input at a time needs to be kept in memory.
+ *
+ * Objects of each input are copied verbatim, only renumbered; the page tree root of each input is
+ * hung below a common page tree root. Supports PDFs with a classic cross-reference table and no
+ * incremental updates, as written by Chromium's `printToPdf()`.
+ */
+class PdfMerger final
+{
+public:
+    explicit PdfMerger(QIODevice& aOutput);
+    ~PdfMerger();
+
+    bool append(QByteArray const& aPdf);
+    bool finish();
+
+    int pageCount() const;
+
+private:
+    struct Data;
+    std::unique_ptr<Data> d;
+};
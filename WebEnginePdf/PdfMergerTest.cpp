@@ -0,0 +1,141 @@
+#include "PdfMergerTest.h"
+
+#include "PdfMerger.h"
+
+#include <QBuffer>
+#include <QRegularExpression>
+
+
+namespace
+{
+// a minimal PDF like Chromium writes it: catalog, page tree, pages w/ content streams, info
+QByteArray makePdf(int const aPages, QByteArray const& aTitle)
+{
+    QList<QByteArray> objects {"<< /Type /Catalog /Pages 2 0 R >>", ""};
+
+    QByteArray kids;
+    for (auto i = 0; i < aPages; ++i)
+    {
+        auto const page = objects.size() + 1;
+        kids += QByteArray::number(page) + " 0 R ";
+
+        QByteArray const content = "BT 3 0 R ET";
+        objects << "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 420 595] /Contents "
+                           + QByteArray::number(page + 1) + " 0 R >>";
+        objects << "<< /Length " + QByteArray::number(content.size()) + " >>\nstream\n" + content
+                           + "\nendstream";
+    }
+    objects[1] = "<< /Type /Pages /Kids [" + kids + "] /Count " + QByteArray::number(aPages)
+                 + " >>";
+    objects << "<< /Title (" + aTitle + ") >>";
+
+    QByteArray pdf = "%PDF-1.4\n";
+    QByteArray xref = "xref\n0 " + QByteArray::number(objects.size() + 1)
+                      + "\n0000000000 65535 f\r\n";
+    for (auto i = 0; i < objects.size(); ++i)
+    {
+        xref += QByteArray::number(pdf.size()).rightJustified(10, '0') + " 00000 n\r\n";
+        pdf += QByteArray::number(i + 1) + " 0 obj\n" + objects[i] + "\nendobj\n";
+    }
+
+    auto const startxref = pdf.size();
+    return pdf + xref + "trailer\n<< /Size " + QByteArray::number(objects.size() + 1)
+           + " /Root 1 0 R /Info " + QByteArray::number(objects.size()) + " 0 R >>\nstartxref\n"
+           + QByteArray::number(startxref) + "\n%%EOF\n";
+}
+
+QByteArray merge(QList<QByteArray> const& aPdfs, int* aPageCount = nullptr)
+{
+    QByteArray merged;
+    QBuffer buffer(&merged);
+    (void) buffer.open(QIODevice::WriteOnly);
+
+    PdfMerger merger(buffer);
+    for (auto const& pdf : aPdfs)
+    {
+        if (!merger.append(pdf))
+        {
+            return {};
+        }
+    }
+    if (!merger.finish())
+    {
+        return {};
+    }
+
+    if (aPageCount)
+    {
+        *aPageCount = merger.pageCount();
+    }
+    return merged;
+}
+
+} // namespace
+
+
+void PdfMergerTest::testThatMergingConcatenatesAllPagesBelowOnePageTree()
+{
+    // ARRANGE - a PDF with 2 pages (objects 1..7) and one with 1 page (objects 1..5)
+    auto const first = makePdf(2, "first");
+    auto const second = makePdf(1, "second");
+
+    // ACT
+    auto pageCount = 0;
+    auto const merged = merge({first, second}, &pageCount);
+
+    // ASSERT - objects of the first PDF are shifted by 2, of the second by 2 + 7
+    QCOMPARE(pageCount, 3);
+    QVERIFY(merged.startsWith("%PDF-1.4\n"));
+    QVERIFY(merged.contains("1 0 obj\n<< /Type /Pages /Kids [ 4 0 R 11 0 R ] /Count 3 >>"));
+    QVERIFY(merged.contains("2 0 obj\n<< /Type /Catalog /Pages 1 0 R >>"));
+    QVERIFY(merged.contains(
+            "4 0 obj\n<< /Parent 1 0 R /Type /Pages /Kids [5 0 R 7 0 R ] /Count 2"));
+    QVERIFY(merged.contains("11 0 obj\n<< /Parent 1 0 R /Type /Pages /Kids [12 0 R ] /Count 1"));
+    QVERIFY(merged.contains("7 0 obj\n<< /Type /Page /Parent 4 0 R"));
+    QVERIFY(merged.contains("/Contents 13 0 R"));
+
+    // ASSERT - the catalogs of the inputs are gone, the info of the first one is kept
+    QVERIFY(!merged.contains("\n3 0 obj"));
+    QVERIFY(!merged.contains("\n10 0 obj"));
+    QVERIFY(merged.contains("/Root 2 0 R /Info 9 0 R"));
+
+    // ASSERT - every cross-reference entry points to its object
+    auto const startxref = QRegularExpression("startxref\\n(\\d+)")
+                                   .match(QString::fromLatin1(merged))
+                                   .captured(1)
+                                   .toInt();
+    QVERIFY(merged.mid(startxref).startsWith("xref\n0 15\n"));
+
+    auto const entries = merged.mid(startxref + 10, 15 * 20);
+    for (auto i = 1; i < 15; ++i)
+    {
+        auto const entry = entries.mid(i * 20, 20);
+        if (entry.endsWith("n\r\n"))
+        {
+            auto const offset = entry.left(10).toInt();
+            QVERIFY2(merged.mid(offset).startsWith(QByteArray::number(i) + " 0 obj"),
+                     qPrintable(QString("object %1 not at %2").arg(i).arg(offset)));
+        }
+    }
+}
+
+
+void PdfMergerTest::testThatMergingKeepsStreamsAndStringsUntouched()
+{
+    // ACT
+    auto const merged = merge({makePdf(1, "Chunk 1 0 R"), makePdf(1, "other")});
+
+    // ASSERT - a stream's binary data and strings may look like references, but are none
+    QCOMPARE(merged.count("stream\nBT 3 0 R ET\nendstream"), 2);
+    QVERIFY(merged.contains("<< /Title (Chunk 1 0 R) >>"));
+}
+
+
+void PdfMergerTest::testThatMergingRejectsInvalidInput()
+{
+    QVERIFY(merge({"not a PDF"}).isEmpty());
+    QVERIFY(merge({}).isEmpty());
+}
+
+
+QTEST_MAIN(PdfMergerTest)
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QTest>
+
+
+class PdfMergerTest final : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    static void testThatMergingConcatenatesAllPagesBelowOnePageTree();
+    static void testThatMergingKeepsStreamsAndStringsUntouched();
+    static void testThatMergingRejectsInvalidInput();
+};
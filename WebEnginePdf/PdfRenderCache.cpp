@@ -0,0 +1,228 @@
+#include "PdfRenderCache.h"
+
+#include <QCache>
+#include <QHash>
+#include <QPdfDocument>
+#include <QPdfDocumentRenderOptions>
+#include <QPointer>
+#include <QSet>
+#include <QThreadPool>
+#include <QVector>
+
+#include <algorithm>
+
+
+namespace
+{
+struct TileKey
+{
+    int page;
+    QSize scaledPageSize;
+    QPoint tile;
+
+    bool operator==(TileKey const& other) const
+    {
+        return page == other.page && scaledPageSize == other.scaledPageSize && tile == other.tile;
+    }
+};
+
+uint qHash(TileKey const& key, uint const seed = 0)
+{
+    return ::qHash(key.page, seed) ^ ::qHash(key.scaledPageSize.width(), seed)
+           ^ ::qHash(key.scaledPageSize.height() << 16, seed) ^ ::qHash(key.tile.x() << 8, seed)
+           ^ ::qHash(key.tile.y() << 24, seed);
+}
+
+// visible tiles are rendered before prefetched ones
+constexpr int VisiblePriority = 1;
+constexpr int PrefetchPriority = 0;
+
+} // namespace
+
+
+struct PdfRenderCache::Data
+{
+    QPointer<QPdfDocument> document;
+    QThreadPool workers;
+
+    // read once per loaded document - asking the document would wait for a running render
+    QVector<QSizeF> pageSizes;
+
+    // the cost of a tile is its size in KiB
+    QCache<TileKey, QImage> tiles {64 * 1024};
+    QSet<TileKey> pending;
+
+    // incremented whenever the document changes, so results of outdated renders are dropped
+    quint64 generation = 0;
+
+    void schedule(PdfRenderCache* aCache, TileKey const& key, int const priority)
+    {
+        if (!document || tiles.contains(key) || pending.contains(key))
+        {
+            return;
+        }
+        pending.insert(key);
+
+        auto* const doc = document.data();
+        auto const gen = generation;
+        auto const cache = QPointer<PdfRenderCache>(aCache);
+
+        workers.start(QRunnable::create([=]() {
+                          auto const tileRect =
+                                  QRect(key.tile * TileSize, QSize(TileSize, TileSize))
+                                          .intersected(QRect({}, key.scaledPageSize));
+
+                          QPdfDocumentRenderOptions options;
+                          options.setScaledSize(key.scaledPageSize);
+                          options.setScaledClipRect(tileRect);
+                          auto const image = doc->render(key.page, tileRect.size(), options);
+
+                          QMetaObject::invokeMethod(
+                                  cache,
+                                  [=]() {
+                                      if (cache)
+                                      {
+                                          cache->d->finished(cache, gen, key, image);
+                                      }
+                                  },
+                                  Qt::QueuedConnection);
+                      }),
+                      priority);
+    }
+
+    void finished(PdfRenderCache* aCache,
+                  quint64 const gen,
+                  TileKey const& key,
+                  QImage const& image)
+    {
+        if (gen != generation)
+        {
+            return;
+        }
+
+        pending.remove(key);
+        if (!image.isNull())
+        {
+            tiles.insert(key, new QImage(image), std::max(1, int(image.sizeInBytes() / 1024)));
+            emit aCache->tileReady(key.page);
+        }
+    }
+
+    void documentStatusChanged()
+    {
+        pageSizes.clear();
+        if (document && document->status() == QPdfDocument::Ready)
+        {
+            pageSizes.resize(document->pageCount());
+            for (auto i = 0; i < pageSizes.size(); ++i)
+            {
+                pageSizes[i] = document->pageSize(i);
+            }
+        }
+    }
+
+    static QPoint tileCount(QSize const& aScaledPageSize)
+    {
+        return {(aScaledPageSize.width() + TileSize - 1) / TileSize,
+                (aScaledPageSize.height() + TileSize - 1) / TileSize};
+    }
+};
+
+
+PdfRenderCache::PdfRenderCache(QObject* aParent) : QObject(aParent), d(std::make_unique<Data>())
+{
+    // pdfium renders one page at a time anyway, see above
+    d->workers.setMaxThreadCount(1);
+}
+PdfRenderCache::~PdfRenderCache()
+{
+    // workers access the document, so they must finish before it could possibly vanish
+    d->workers.clear();
+    d->workers.waitForDone();
+}
+
+
+void PdfRenderCache::setDocument(QPdfDocument* aDocument)
+{
+    if (d->document)
+    {
+        disconnect(d->document, nullptr, this, nullptr);
+    }
+
+    // the previous document may be deleted right after - the one render possibly still running
+    // on it has to finish first
+    clear();
+    d->workers.waitForDone();
+
+    d->document = aDocument;
+    d->documentStatusChanged();
+
+    if (aDocument)
+    {
+        connect(aDocument, &QPdfDocument::statusChanged, this, [this]() {
+            clear();
+            d->documentStatusChanged();
+        });
+    }
+}
+
+
+void PdfRenderCache::setMemoryBudget(qint64 const aBytes)
+{
+    d->tiles.setMaxCost(int(std::max<qint64>(1, aBytes / 1024)));
+}
+
+
+int PdfRenderCache::pageCount() const
+{
+    return d->pageSizes.size();
+}
+
+
+QSizeF PdfRenderCache::pageSize(int const aPage) const
+{
+    return d->pageSizes.value(aPage);
+}
+
+
+QImage PdfRenderCache::tile(int const aPage, QSize const& aScaledPageSize, QPoint const& aTile)
+{
+    TileKey const key {aPage, aScaledPageSize, aTile};
+
+    if (auto const* const cached = d->tiles.object(key); cached)
+    {
+        return *cached;
+    }
+
+    d->schedule(this, key, VisiblePriority);
+    return {};
+}
+
+
+void PdfRenderCache::prefetch(int const aPage, QSize const& aScaledPageSize)
+{
+    if (!d->document || aPage < 0 || aPage >= pageCount())
+    {
+        return;
+    }
+
+    auto const count = Data::tileCount(aScaledPageSize);
+    for (auto y = 0; y < count.y(); ++y)
+    {
+        for (auto x = 0; x < count.x(); ++x)
+        {
+            d->schedule(this, {aPage, aScaledPageSize, {x, y}}, PrefetchPriority);
+        }
+    }
+}
+
+
+void PdfRenderCache::clear()
+{
+    // a render already running can't be cancelled - but isn't waited for, its result is dropped
+    d->workers.clear();
+
+    ++d->generation;
+    d->pending.clear();
+    d->tiles.clear();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QImage>
+#include <QObject>
+#include <QRect>
+#include <QSizeF>
+
+#include <memory>
+
+class QPdfDocument;
+
+
+/**
+ * Rasterizes the pages of a QPdfDocument in tiles on a worker thread and keeps the results in a LRU
+ * cache bounded by a memory budget - so the GUI thread never waits on QPdfDocument::render().
+ *
+ * QtPdf serializes every call into pdfium with one global lock, so rendering on more than one
+ * thread doesn't gain anything, and any other call into the document on the GUI thread would wait
+ * for the tile being rendered. The page count and page sizes are therefore read once when the
+ * document was loaded, and are to be taken from `pageCount()` and `pageSize()`.
+ *
+ * `tile()` returns a cached tile immediately or schedules its rendering and returns a null image;
+ * `tileReady()` is emitted once it is available. `prefetch()` renders whole pages with lower
+ * priority than the visible tiles.
+ */
+class PdfRenderCache final : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int TileSize = 256;
+
+    explicit PdfRenderCache(QObject* aParent = nullptr);
+    ~PdfRenderCache() override;
+
+    void setDocument(QPdfDocument* aDocument);
+    void setMemoryBudget(qint64 aBytes);
+
+    int pageCount() const;
+    QSizeF pageSize(int aPage) const;
+
+    QImage tile(int aPage, QSize const& aScaledPageSize, QPoint const& aTile);
+    void prefetch(int aPage, QSize const& aScaledPageSize);
+
+    void clear();
+
+signals:
+    void tileReady(int aPage);
+
+private:
+    struct Data;
+    std::unique_ptr<Data> d;
+};
@@ -0,0 +1,121 @@
+#include "PdfTileView.h"
+
+#include "PdfRenderCache.h"
+
+#include <QPaintEvent>
+#include <QPainter>
+#include <QPdfDocument>
+#include <QPdfPageNavigation>
+#include <QPointer>
+
+
+struct PdfTileView::Data
+{
+    QPointer<QPdfDocument> document;
+    QPdfPageNavigation* navigation = nullptr;
+    PdfRenderCache* cache = nullptr;
+
+    // the page fit into the widget, in logical pixels - the page sizes are taken from the cache,
+    // as the document would wait for a running render
+    QRect pageRect(int const aPage, QSize const& aViewSize) const
+    {
+        auto const size = cache->pageSize(aPage).scaled(aViewSize, Qt::KeepAspectRatio).toSize();
+        return {QPoint((aViewSize.width() - size.width()) / 2,
+                       (aViewSize.height() - size.height()) / 2),
+                size};
+    }
+};
+
+
+PdfTileView::PdfTileView(QWidget* aParent) : QWidget(aParent), d(std::make_unique<Data>())
+{
+    d->navigation = new QPdfPageNavigation(this);
+    d->cache = new PdfRenderCache(this);
+
+    connect(d->navigation, &QPdfPageNavigation::currentPageChanged, this, [this]() { update(); });
+    connect(d->cache, &PdfRenderCache::tileReady, this, [this](int const aPage) {
+        if (aPage == d->navigation->currentPage())
+        {
+            update();
+        }
+    });
+}
+PdfTileView::~PdfTileView()
+{
+    d->cache->setDocument(nullptr);
+}
+
+
+void PdfTileView::setDocument(QPdfDocument* aDocument)
+{
+    if (d->document)
+    {
+        disconnect(d->document, nullptr, this, nullptr);
+    }
+
+    d->document = aDocument;
+    d->navigation->setDocument(aDocument);
+    d->cache->setDocument(aDocument);
+
+    if (aDocument)
+    {
+        connect(aDocument, &QPdfDocument::statusChanged, this, [this]() { update(); });
+    }
+    update();
+}
+
+
+void PdfTileView::setMemoryBudget(qint64 const aBytes)
+{
+    d->cache->setMemoryBudget(aBytes);
+}
+
+
+QPdfPageNavigation* PdfTileView::pageNavigation() const
+{
+    return d->navigation;
+}
+
+
+void PdfTileView::paintEvent(QPaintEvent* aEvent)
+{
+    QPainter painter(this);
+    painter.fillRect(aEvent->rect(), palette().dark());
+
+    if (!d->document || d->cache->pageCount() == 0)
+    {
+        return;
+    }
+
+    auto const page = d->navigation->currentPage();
+    auto const rect = d->pageRect(page, size());
+    painter.fillRect(rect, Qt::white);
+
+    // tiles are rendered in device pixels to stay sharp on high DPI screens
+    auto const dpr = devicePixelRatioF();
+    auto const scaledPageSize = rect.size() * dpr;
+    auto const tileSize = PdfRenderCache::TileSize / dpr;
+
+    auto const visible = aEvent->rect().intersected(rect).translated(-rect.topLeft());
+    for (auto y = int(visible.top() / tileSize); y <= int(visible.bottom() / tileSize); ++y)
+    {
+        for (auto x = int(visible.left() / tileSize); x <= int(visible.right() / tileSize); ++x)
+        {
+            // a missing tile stays blank until PdfRenderCache::tileReady() triggers a repaint
+            if (auto const tile = d->cache->tile(page, scaledPageSize, {x, y}); !tile.isNull())
+            {
+                QPointF const topLeft(rect.left() + x * tileSize, rect.top() + y * tileSize);
+                painter.drawImage(QRectF(topLeft, tile.size() / dpr), tile);
+            }
+        }
+    }
+
+    // have the neighbours ready before the user navigates to them
+    for (auto const neighbour : {page + 1, page - 1})
+    {
+        if (neighbour >= 0 && neighbour < d->cache->pageCount())
+        {
+            d->cache->prefetch(neighbour, d->pageRect(neighbour, size()).size() * dpr);
+        }
+    }
+}
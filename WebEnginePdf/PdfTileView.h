@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QWidget>
+
+#include <memory>
+
+class QPdfDocument;
+class QPdfPageNavigation;
+
+
+/**
+ * Shows one page of a QPdfDocument fit into the widget, painted from the tiles of a
+ * PdfRenderCache - the neighbouring pages are prefetched, so turning pages doesn't stall the GUI.
+ */
+class PdfTileView final : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PdfTileView(QWidget* aParent = nullptr);
+    ~PdfTileView() override;
+
+    void setDocument(QPdfDocument* aDocument);
+    void setMemoryBudget(qint64 aBytes);
+
+    QPdfPageNavigation* pageNavigation() const;
+
+protected:
+    void paintEvent(QPaintEvent* aEvent) override;
+
+private:
+    struct Data;
+    std::unique_ptr<Data> d;
+};
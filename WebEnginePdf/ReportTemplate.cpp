@@ -0,0 +1,140 @@
+#include "ReportTemplate.h"
+
+#include <QDebug>
+#include <QJsonDocument>
+#include <QQueue>
+#include <QWebEnginePage>
+
+#include <algorithm>
+
+
+namespace
+{
+struct Job
+{
+    QJsonObject data;
+    QPageLayout layout;
+    ReportTemplate::Callback callback;
+};
+
+struct PooledPage
+{
+    QWebEnginePage* page = nullptr;
+    bool ready = false;
+    bool busy = false;
+    bool failed = false;
+};
+
+} // namespace
+
+
+struct ReportTemplate::Data
+{
+    QList<PooledPage> pool;
+    QQueue<Job> jobs;
+
+    void dispatch()
+    {
+        // w/o any page able to load the template, jobs are completed right away w/o a PDF
+        if (std::all_of(pool.cbegin(), pool.cend(), [](auto const& p) { return p.failed; }))
+        {
+            while (!jobs.isEmpty())
+            {
+                jobs.dequeue().callback({});
+            }
+            return;
+        }
+
+        for (auto& pooled : pool)
+        {
+            if (jobs.isEmpty())
+            {
+                return;
+            }
+
+            if (pooled.ready && !pooled.busy)
+            {
+                run(pooled, jobs.dequeue());
+            }
+        }
+    }
+
+    void run(PooledPage& pooled, Job job)
+    {
+        pooled.busy = true;
+
+        auto* const page = pooled.page;
+        auto const script = QString("renderReport(%1)")
+                                    .arg(QString::fromUtf8(QJsonDocument(job.data).toJson(
+                                            QJsonDocument::Compact)));
+
+        page->runJavaScript(script, [=](QVariant const& changed) {
+            qDebug() << "template re-rendered" << changed.toInt() << "DOM nodes";
+
+            page->printToPdf(
+                    [=](QByteArray const& pdf) {
+                        job.callback(pdf);
+
+                        release(page);
+                    },
+                    job.layout);
+        });
+    }
+
+    void release(QWebEnginePage* aPage)
+    {
+        for (auto& pooled : pool)
+        {
+            if (pooled.page == aPage)
+            {
+                pooled.busy = false;
+            }
+        }
+        dispatch();
+    }
+
+    void loaded(QWebEnginePage* aPage, bool const aOk)
+    {
+        for (auto& pooled : pool)
+        {
+            if (pooled.page == aPage)
+            {
+                pooled.ready = aOk;
+                pooled.failed = !aOk;
+            }
+        }
+        dispatch();
+    }
+};
+
+
+ReportTemplate::ReportTemplate(QUrl const& aTemplateUrl, int const aPoolSize, QObject* aParent)
+    : QObject(aParent)
+    , d(std::make_unique<Data>())
+{
+    for (auto i = 0; i < std::max(1, aPoolSize); ++i)
+    {
+        auto* const page = new QWebEnginePage(this);
+        d->pool.append({page});
+
+        // the template is loaded and parsed exactly once per pooled page
+        connect(page, &QWebEnginePage::loadFinished, this, [=](bool const ok) {
+            if (!ok)
+            {
+                qCritical() << "unable to load report template" << aTemplateUrl;
+            }
+            d->loaded(page, ok);
+        });
+        page->load(aTemplateUrl);
+    }
+}
+ReportTemplate::~ReportTemplate() = default;
+
+
+void ReportTemplate::render(QJsonObject const& aData,
+                            QPageLayout const& aLayout,
+                            Callback aCallback)
+{
+    d->jobs.enqueue({aData, aLayout, std::move(aCallback)});
+    d->dispatch();
+}
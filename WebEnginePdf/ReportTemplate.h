@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QObject>
+#include <QPageLayout>
+#include <QUrl>
+
+#include <functional>
+#include <memory>
+
+
+/**
+ * Renders reports of the same layout by loading the HTML template only once into a small pool of
+ * QWebEnginePages and binding the data of each report into it through the template's
+ * `renderReport(data)` JavaScript function - which only touches the DOM regions that changed -
+ * before printing the page to PDF.
+ *
+ * Jobs are queued and handed to the next idle page of the pool, results are delivered in memory.
+ * If the template can't be loaded by any page, jobs are completed with an empty PDF.
+ */
+class ReportTemplate final : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void(QByteArray const&)>;
+
+    explicit ReportTemplate(QUrl const& aTemplateUrl,
+                            int aPoolSize = 1,
+                            QObject* aParent = nullptr);
+    ~ReportTemplate() override;
+
+    void render(QJsonObject const& aData, QPageLayout const& aLayout, Callback aCallback);
+
+private:
+    struct Data;
+    std::unique_ptr<Data> d;
+};
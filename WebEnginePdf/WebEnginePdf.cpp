@@ -1,23 +1,55 @@
 #include "WebEnginePdf.h"
 
+#include "ChunkedPdfPrinter.h"
+#include "EmbeddedReports.h"
+#include "ReportTemplate.h"
+#include "XsltTransformCache.h"
 #include "ui_WebEnginePdf.h"
 
+#include <QBuffer>
 #include <QDir>
-#include <QDirIterator>
+#include <QFile>
+#include <QJsonDocument>
 #include <QLineEdit>
 #include <QPageLayout>
 #include <QPdfDocument>
 #include <QPdfPageNavigation>
+#include <QTemporaryFile>
 
 
 struct WebEnginePdf::Data
 {
     Ui::WebEnginePdf ui {};
-    QPdfDocument* document = new QPdfDocument;
-    QString const filename = QDir::temp().filePath("WebEnginePdf.pdf");
+
+    // created with the first PDF shown
+    QPdfDocument* document = nullptr;
+
+    // the last rendered PDF is kept in memory and handed to the viewer through a QBuffer
+    QByteArray pdf;
+    QBuffer pdfBuffer;
+
+    // ... unless it was written to a file anyway - like the merged chunks, no matter how large
+    QString pdfFile;
+
+    // created on first use, keeps the report template loaded for all further reports
+    ReportTemplate* reportTemplate = nullptr;
+
+    // XML reports are transformed to HTML up front, if Qt XmlPatterns is available
+    XsltTransformCache* xsltCache = nullptr;
+
+    // very large paged reports are printed in chunks, merged into a file
+    ChunkedPdfPrinter* chunkedPrinter = nullptr;
+
+    // HTML too large for setHtml() is shown from this file, until the next report is opened
+    std::unique_ptr<QTemporaryFile> largeHtml;
+
+    // every URL opened gets the next number - transformations done for an older one are dropped
+    quint64 openSequence = 0;
 
     ~Data()
     {
+        // the view renders from worker threads - they must be done with the document first
+        ui.pdfView->setDocument(nullptr);
         delete document;
     }
 
@@ -27,6 +59,87 @@ struct WebEnginePdf::Data
         ui.lbPages->setText(
                 QString("Page %1 / %2").arg(nav->currentPage() + 1).arg(nav->pageCount()));
     }
+
+    void storePdf(QByteArray const& aPdf)
+    {
+        pdf = aPdf;
+        pdfFile.clear();
+        ui.btnLoadPDF->setEnabled(!pdf.isEmpty());
+
+        if (ui.cbWriteFile->isChecked() && !pdf.isEmpty())
+        {
+            writeToUniqueFile(pdf);
+        }
+    }
+
+    void storePdfFile(QString const& aFileName)
+    {
+        pdf.clear();
+        pdfFile = aFileName;
+        ui.btnLoadPDF->setEnabled(true);
+    }
+
+    void showPdf()
+    {
+        if (!document)
+        {
+            document = new QPdfDocument;
+        }
+
+        // the document reads from the buffer, so it must not be touched while still loaded
+        document->close();
+        pdfBuffer.close();
+
+        if (!pdfFile.isEmpty())
+        {
+            (void) document->load(pdfFile);
+            return;
+        }
+
+        pdfBuffer.setData(pdf);
+        (void) pdfBuffer.open(QIODevice::ReadOnly);
+        document->load(&pdfBuffer);
+    }
+
+    void setHtml(QByteArray const& aHtml, QUrl const& aBaseUrl)
+    {
+        // setHtml() is limited to 2 MB - larger documents have to be loaded from a file
+        if (aHtml.size() < 2 * 1024 * 1024)
+        {
+            ui.webView->setHtml(QString::fromUtf8(aHtml), aBaseUrl);
+            return;
+        }
+
+        largeHtml = std::make_unique<QTemporaryFile>(
+                QDir::temp().filePath("WebEnginePdf_XXXXXX.html"));
+        if (!largeHtml->open() || largeHtml->write(aHtml) != aHtml.size() || !largeHtml->flush())
+        {
+            qCritical() << "unable to write HTML to" << largeHtml->fileName();
+            return;
+        }
+        ui.webView->setUrl(QUrl::fromLocalFile(largeHtml->fileName()));
+    }
+
+    static QString writeToUniqueFile(QByteArray const& aPdf)
+    {
+        // every job gets its own file, so concurrent renders don't clobber each other
+        QTemporaryFile file(QDir::temp().filePath("WebEnginePdf_XXXXXX.pdf"));
+        file.setAutoRemove(false);
+
+        if (!file.open() || file.write(aPdf) != aPdf.size())
+        {
+            qCritical() << "unable to write PDF to" << file.fileName();
+            return {};
+        }
+
+        qInfo() << "PDF written to" << file.fileName();
+        return file.fileName();
+    }
+
+    static QString toFileName(QUrl const& aUrl)
+    {
+        return aUrl.scheme() == "qrc" ? ":" + aUrl.path() : aUrl.toLocalFile();
+    }
 };
 
 
@@ -37,26 +150,44 @@ WebEnginePdf::WebEnginePdf() : d(std::make_unique<Data>())
     ui->setupUi(this);
     resize(384, 443);
 
-    // populate all embedded resources into the combobox
-    QRegularExpression const re(":/embedded/[a-zA-Z-_/]+((\\.htm[l]?)|(\\.xml))");
-    QStringList resources {""};
-    QDirIterator it(":", QDirIterator::Subdirectories);
-    while (it.hasNext())
-    {
-        auto const& url = it.next();
-        qDebug() << url;
-        if (re.match(url).hasMatch())
-        {
-            resources.append("qrc://" + url.mid(1));
-        }
-    }
-    ui->edUrl->addItems(resources);
+    d->xsltCache = new XsltTransformCache(this);
+    d->chunkedPrinter = new ChunkedPdfPrinter(this);
+
+    // populate all embedded reports into the combobox - indexed at build time
+    ui->edUrl->addItems(QStringList {""} + embeddedReports());
 
     // open URL by selecting from ComboBox or entering an arbitrary URL
     auto const openUrl = [=]() {
         if (auto const url = ui->edUrl->currentText().trimmed(); !url.isEmpty())
         {
-            ui->webView->setUrl(QUrl(url));
+            auto const sequence = ++d->openSequence;
+            d->largeHtml.reset();
+
+            if (auto const xml = Data::toFileName(QUrl(url));
+                XsltTransformCache::isAvailable() && xml.endsWith(".xml"))
+            {
+                d->xsltCache->transform(xml, [=](QByteArray const& html) {
+                    if (sequence != d->openSequence)
+                    {
+                        // another URL was opened in the meantime
+                        return;
+                    }
+
+                    if (html.isEmpty())
+                    {
+                        // fall back to have Chromium apply the stylesheet itself
+                        ui->webView->setUrl(QUrl(url));
+                    }
+                    else
+                    {
+                        d->setHtml(html, QUrl(url));
+                    }
+                });
+            }
+            else
+            {
+                ui->webView->setUrl(QUrl(url));
+            }
 
             ui->tabWidget->setCurrentWidget(ui->tabWebWidget);
         }
@@ -66,11 +197,36 @@ WebEnginePdf::WebEnginePdf() : d(std::make_unique<Data>())
 
     // or just write your own HTML and send it directly to the browser
     connect(ui->btnToBrowser, &QPushButton::clicked, [=]() {
+        ++d->openSequence;
         ui->webView->setHtml(ui->edHtmlSource->toPlainText());
         ui->tabWidget->setCurrentWidget(ui->tabWebWidget);
     });
 
 
+    // or bind JSON data into the report template, that is loaded only once, and print it directly
+    connect(ui->btnTemplateToPDF, &QPushButton::clicked, [=]() {
+        QJsonParseError error {};
+        auto const json = QJsonDocument::fromJson(ui->edHtmlSource->toPlainText().toUtf8(), &error);
+        if (!json.isObject())
+        {
+            qWarning() << "HTML source is not a JSON object:" << error.errorString();
+            return;
+        }
+
+        if (!d->reportTemplate)
+        {
+            d->reportTemplate = new ReportTemplate(
+                    QUrl("qrc:/embedded/template/report.html"), 1, this);
+        }
+
+        QPageLayout const& layout = {QPageSize(QPageSize::A5), QPageLayout::Portrait, QMarginsF()};
+        d->reportTemplate->render(json.object(), layout, [=](QByteArray const& pdf) {
+            d->storePdf(pdf);
+            ui->btnLoadPDF->click();
+        });
+    });
+
+
     // block saving to PDF while the HTML is still being loaded
     connect(ui->webView, &QWebEngineView::loadStarted, [=]() {
         ui->btnSavePDF->setEnabled(false);
@@ -85,19 +241,51 @@ WebEnginePdf::WebEnginePdf() : d(std::make_unique<Data>())
         {
             QPageLayout const& layout = {
                     QPageSize(QPageSize::A5), QPageLayout::Portrait, QMarginsF()};
-            page->printToPdf(d->filename, layout);
+            page->printToPdf([=](QByteArray const& pdf) { d->storePdf(pdf); }, layout);
+        }
+    });
+
+    connect(ui->btnChunkedPDF, &QPushButton::clicked, [=]() {
+        auto const url = QUrl(ui->edUrl->currentText().trimmed());
+
+        QTemporaryFile target(QDir::temp().filePath("WebEnginePdf_XXXXXX.pdf"));
+        target.setAutoRemove(false);
+        if (!target.open())
+        {
+            qCritical() << "unable to print" << url << "in chunks";
+            return;
         }
+
+        ui->btnChunkedPDF->setEnabled(false);
+
+        QPageLayout const& layout = {QPageSize(QPageSize::A5), QPageLayout::Portrait, QMarginsF()};
+        // the source is read by the printer piece by piece
+        d->chunkedPrinter->print(Data::toFileName(url),
+                                 url,
+                                 layout,
+                                 target.fileName(),
+                                 [=, fileName = target.fileName()](bool const ok) {
+                                     ui->btnChunkedPDF->setEnabled(true);
+
+                                     if (ok)
+                                     {
+                                         qInfo() << "PDF written to" << fileName;
+                                         d->storePdfFile(fileName);
+                                     }
+                                     else
+                                     {
+                                         (void) QFile::remove(fileName);
+                                     }
+                                 });
     });
 
 
     // PDF loading and navigation
     connect(ui->btnLoadPDF, &QPushButton::clicked, [=]() {
-        d->document->load(d->filename);
+        d->showPdf();
         ui->pdfView->setDocument(d->document);
 
-        ui->pdfView->setPageMode(QPdfView::SinglePage);
         ui->pdfView->pageNavigation()->setCurrentPage(0);
-        ui->pdfView->setZoomMode(QPdfView::FitInView);
         d->updatePageLabel();
 
         ui->tabWidget->setCurrentWidget(ui->tabPdfWidget);
@@ -114,5 +302,16 @@ WebEnginePdf::WebEnginePdf() : d(std::make_unique<Data>())
     connect(ui->pdfView->pageNavigation(), &QPdfPageNavigation::currentPageChanged, [=]() {
         d->updatePageLabel();
     });
+    connect(ui->pdfView->pageNavigation(), &QPdfPageNavigation::pageCountChanged, [=]() {
+        d->updatePageLabel();
+    });
 }
 WebEnginePdf::~WebEnginePdf() = default;
+
+
+void WebEnginePdf::warmUp()
+{
+    // creating the first page starts the WebEngine profile and its render process - it's done
+    // once the window is shown instead of delaying it, so loading the first report is fast
+    (void) d->ui.webView->page();
+}
@@ -13,6 +13,8 @@ public:
     WebEnginePdf();
     ~WebEnginePdf() override;
 
+    void warmUp();
+
 private:
     struct Data;
     std::unique_ptr<Data> d;
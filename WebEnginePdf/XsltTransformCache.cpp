@@ -0,0 +1,181 @@
+#include "XsltTransformCache.h"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QThreadPool>
+#include <QXmlStreamReader>
+
+#ifdef WEBENGINEPDF_HAS_XMLPATTERNS
+#include <QThreadStorage>
+#include <QXmlQuery>
+#endif
+
+
+#ifdef WEBENGINEPDF_HAS_XMLPATTERNS
+namespace
+{
+// the stylesheet is referenced by a processing instruction in the XML prolog - so reading stops at
+// the first element, no matter how large the XML is
+QString findStylesheet(QString const& aXmlFileName)
+{
+    QFile f(aXmlFileName);
+    if (!f.open(QIODevice::ReadOnly))
+    {
+        return {};
+    }
+
+    QXmlStreamReader reader(&f);
+    while (!reader.atEnd() && reader.readNext() != QXmlStreamReader::StartElement)
+    {
+        if (reader.isProcessingInstruction()
+            && reader.processingInstructionTarget() == QLatin1String("xml-stylesheet"))
+        {
+            QRegularExpression const re("href\\s*=\\s*[\"']([^\"']+)[\"']");
+            if (auto const match = re.match(reader.processingInstructionData()); match.hasMatch())
+            {
+                return QFileInfo(aXmlFileName).dir().filePath(match.captured(1));
+            }
+        }
+    }
+
+    return {};
+}
+
+QUrl toUrl(QString const& aFileName)
+{
+    return aFileName.startsWith(':') ? QUrl("qrc" + aFileName) : QUrl::fromLocalFile(aFileName);
+}
+
+// compiled stylesheets, per worker thread - as a QXmlQuery must not be shared between threads
+QThreadStorage<QHash<QString, QXmlQuery>> compiledStylesheets;
+
+} // namespace
+#endif
+
+
+struct XsltTransformCache::Data
+{
+    QThreadPool workers;
+
+    // stylesheet sources are read only once and shared by all workers
+    QMutex mutex;
+    QHash<QString, QString> stylesheets;
+
+    QString stylesheetSource(QString const& aFileName)
+    {
+        QMutexLocker const lock(&mutex);
+
+        if (auto const it = stylesheets.constFind(aFileName); it != stylesheets.constEnd())
+        {
+            return *it;
+        }
+
+        QFile f(aFileName);
+        if (!f.open(QIODevice::ReadOnly))
+        {
+            qCritical() << "unable to read stylesheet:" << aFileName;
+            return {};
+        }
+
+        return *stylesheets.insert(aFileName, QString::fromUtf8(f.readAll()));
+    }
+
+    QByteArray transform(QString const& aXmlFileName)
+    {
+#ifdef WEBENGINEPDF_HAS_XMLPATTERNS
+        auto const stylesheetFileName = findStylesheet(aXmlFileName);
+        if (stylesheetFileName.isEmpty())
+        {
+            qWarning() << "no XSLT stylesheet referenced in" << aXmlFileName;
+            return {};
+        }
+
+        QFile xml(aXmlFileName);
+        if (!xml.open(QIODevice::ReadOnly))
+        {
+            qCritical() << "unable to read XML:" << aXmlFileName;
+            return {};
+        }
+
+        auto& compiled = compiledStylesheets.localData();
+        auto it = compiled.find(stylesheetFileName);
+        if (it == compiled.end())
+        {
+            QXmlQuery query(QXmlQuery::XSLT20);
+            query.setFocus(&xml);
+            query.setQuery(stylesheetSource(stylesheetFileName), toUrl(stylesheetFileName));
+            it = compiled.insert(stylesheetFileName, query);
+        }
+        else
+        {
+            it->setFocus(&xml);
+        }
+
+        // the result is written straight into the buffer while being evaluated
+        QByteArray html;
+        QBuffer out(&html);
+        (void) out.open(QIODevice::WriteOnly);
+
+        if (!it->isValid() || !it->evaluateTo(&out))
+        {
+            qCritical() << "unable to apply" << stylesheetFileName << "to" << aXmlFileName;
+            return {};
+        }
+
+        return html;
+#else
+        Q_UNUSED(aXmlFileName)
+        return {};
+#endif
+    }
+};
+
+
+XsltTransformCache::XsltTransformCache(QObject* aParent)
+    : QObject(aParent)
+    , d(std::make_unique<Data>())
+{
+}
+XsltTransformCache::~XsltTransformCache()
+{
+    d->workers.clear();
+    d->workers.waitForDone();
+}
+
+
+bool XsltTransformCache::isAvailable()
+{
+#ifdef WEBENGINEPDF_HAS_XMLPATTERNS
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+void XsltTransformCache::transform(QString const& aXmlFileName, Callback aCallback)
+{
+    auto const self = QPointer<XsltTransformCache>(this);
+
+    d->workers.start(QRunnable::create([=]() {
+        auto const html = d->transform(aXmlFileName);
+
+        QMetaObject::invokeMethod(
+                self,
+                [=]() {
+                    if (self)
+                    {
+                        aCallback(html);
+                    }
+                },
+                Qt::QueuedConnection);
+    }));
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include <functional>
+#include <memory>
+
+
+/**
+ * Transforms XML files referencing an XSLT stylesheet (`<?xml-stylesheet href="..."?>`) to HTML
+ * before they are handed to the browser - instead of having Chromium apply the stylesheet
+ * single-threaded in the renderer on every load.
+ *
+ * Stylesheets are read and compiled once per worker thread and reused for every XML using them,
+ * jobs run in parallel on a thread pool and write their output into memory. The input is not
+ * streamed - QXmlQuery builds the whole XML tree in memory first. The callback is
+ * invoked on the thread of the cache with the HTML - or an empty array if the transformation
+ * failed or is not available, because Qt XmlPatterns wasn't found at build time.
+ */
+class XsltTransformCache final : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void(QByteArray const&)>;
+
+    explicit XsltTransformCache(QObject* aParent = nullptr);
+    ~XsltTransformCache() override;
+
+    static bool isAvailable();
+
+    void transform(QString const& aXmlFileName, Callback aCallback);
+
+private:
+    struct Data;
+    std::unique_ptr<Data> d;
+};
@@ -1,13 +1,86 @@
 #include "WebEnginePdf.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QTimer>
+
+#include <functional>
+
+
+namespace
+{
+// calls back when the widget is painted the first time - a window just shown isn't exposed yet
+class FirstPaint final : public QObject
+{
+public:
+    FirstPaint(QWidget& aWidget, std::function<void()> aCallback)
+        : QObject(&aWidget)
+        , callback(std::move(aCallback))
+    {
+        aWidget.installEventFilter(this);
+    }
+
+    bool eventFilter(QObject* aWatched, QEvent* aEvent) override
+    {
+        if (aEvent->type() == QEvent::Paint)
+        {
+            aWatched->removeEventFilter(this);
+            callback();
+        }
+        return false;
+    }
+
+private:
+    std::function<void()> const callback;
+};
+
+} // namespace
 
 
 int main(int argc, char *argv[])
 {
+    QElapsedTimer startup;
+    startup.start();
+
     QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    (void) parser.addHelpOption();
+    (void) parser.addOption( //
+            {"benchmark-startup",
+             "quit right after the window was painted the first time - failing if that took "
+             "longer than <ms>",
+             "ms"});
+    parser.process(a);
+
     WebEnginePdf w;
 
+    (void) new FirstPaint(w, [&]() {
+        auto const elapsed = startup.elapsed();
+        qInfo() << "time to first window:" << elapsed << "ms";
+
+        // not from within the paint event
+        QTimer::singleShot(0, &w, [&, elapsed]() {
+            if (!parser.isSet("benchmark-startup"))
+            {
+                w.warmUp();
+                return;
+            }
+
+            auto const limit = parser.value("benchmark-startup").toLongLong();
+            if (elapsed > limit)
+            {
+                qCritical() << "time to first window exceeds the limit of" << limit << "ms!";
+                QApplication::exit(1);
+                return;
+            }
+            QApplication::quit();
+        });
+    });
+
     w.show();
 
     return a.exec();